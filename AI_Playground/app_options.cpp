@@ -0,0 +1,312 @@
+#include "app_options.h"
+
+#include <charconv>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+template<typename T>
+bool parse_value(std::string_view str, T& value)
+{
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    return ec == std::errc() && ptr == str.data() + str.size();
+}
+
+template<typename T, typename ParseFn>
+bool parse_list(std::string_view str, std::vector<T>& values, ParseFn parse_fn)
+{
+    values.clear();
+    while (!str.empty())
+    {
+        const auto comma = str.find(',');
+        T value{};
+        if (!parse_fn(str.substr(0, comma), value))
+        {
+            return false;
+        }
+        values.push_back(value);
+        str = comma == std::string_view::npos ? std::string_view{} : str.substr(comma + 1);
+    }
+    return !values.empty();
+}
+}
+
+void print_usage(const char* app_name)
+{
+    std::cout << "Usage: " << app_name << " [options]\n"
+        "  --M, --K, --N, --block_size <v[,v..]>   GEMM shape, lists are swept by the benchmark (default: 512, 512, 512, 32)\n"
+        "  --b_kn                                   B and its quantization params stored [K, N] instead of transposed [N, K]\n"
+        "  --quant <uint4|int4|int8|nf4|fp4[,..]>   quantization scheme of B, swept by the benchmark (default: uint4)\n"
+        "  --a_quant <none|row|block[,..]>          CPU: A quantized to int8 per row or per quantization block on the fly, integer\n"
+        "                                           dot products against integer B, swept by the benchmark (default: none)\n"
+        "  --dequant <auto|per_element|folded>      CPU: dequantize B per element in the inner loop, or fold the scale and zero point\n"
+        "                                           into a per block correction after the dot products (default: auto)\n"
+        "  --engine <multiply|lut>                  CPU: multiply-accumulate kernels, or table lookups (T-MAC) for uint4/int4 B with --a_quant\n"
+        "                                           (default: multiply)\n"
+        "  --tuning_cache <path>                    CPU: tuned dequantization, engine, blocking and threads per shape and host, loaded when\n"
+        "                                           the operator is created, they replace --dequant and --engine for the shapes in it\n"
+        "  --autotune                               CPU: time the candidate configs of shapes missing from the tuning cache and add them\n"
+        "  --threads <n>                            CPU worker threads, 0 = all (default: 0)\n"
+        "  --isa <scalar|avx2|avx512|avx512_vnni>   CPU: highest instruction set of the kernels, capped by the host (default: avx512_vnni)\n"
+        "  --batch <n>                              CPU: requests per batched call, of M rows each in the benchmark, A split into them\n"
+        "                                           in the conformance check (default: 1)\n"
+        "  --pin                                    pin CPU worker threads to logical cpus\n"
+        "  --numa                                   NUMA aware CPU scheduling, implies --pin\n"
+        "  --huge_pages                             CPU scratch arena in 2 MB huge pages\n"
+        "  --seed <n>                               seed of the random tensors (default: 0)\n"
+        "  --a_init, --b_init, --scale_init, --zp_init <dist>\n"
+        "                                           constant:<v>, uniform:<min>,<max> or normal:<mean>,<stddev>\n"
+        "                                           (default: normal:0,1, uniform over the codes of the scheme, uniform:0.001,0.02, uniform:0,15)\n"
+        "  --weights <path>                         map B, scales and zero points from a weights file\n"
+        "  --bias                                   epilogue: add a bias[N]\n"
+        "  --act <none|gelu|silu>                   epilogue: activation after the bias (default: none)\n"
+        "  --residual                               epilogue: add a residual[M, N] after the activation\n"
+        "  --requant <output_scale>                 epilogue: int8 output, round(x / output_scale) saturated\n"
+        "  --bias_init, --residual_init <dist>      (default: normal:0,1, normal:0,1)\n"
+        "conformance:\n"
+        "  --loop <n>                               execute iterations per call (default: 1)\n"
+        "  --no_cpu                                 skip the CPU backend\n"
+        "  --cuda                                   run CUDA instead of DML\n"
+        "  --ref_fp64                               accumulate the host golden model in fp64 instead of fp32\n"
+        "  --atol, --rtol <v>                       absolute/relative tolerance (default: 1e-3, 1e-2)\n"
+        "  --ulp <n>                                tolerance in fp16 ulps (default: 0)\n"
+        "  --save_weights <path>                    write the weights file of the operator\n"
+        "  --packed_weights <path>                  CPU: prepacked weights cache, mapped when valid, rewritten otherwise\n"
+        "benchmark:\n"
+        "  --backend <cpu|dml|cuda[,..]>            benchmarked backends (default: cpu)\n"
+        "  --warmup <n>                             warmup iterations (default: 3)\n"
+        "  --iters <n>                              timed iterations (default: 20)\n"
+        "  --stream <n>                             STREAM triad elements per array, 0 = skip (default: 16M)\n"
+        "  --json <path>, --csv <path>              write results\n";
+}
+
+bool parse_args(int argc, char* argv[], app_opts_t& opts)
+{
+    // shapes and block sizes, 0 would divide by zero
+    const auto parse_u32 = [](std::string_view s, std::uint32_t& v) { return parse_value(s, v) && v > 0; };
+    const auto parse_backend = [](std::string_view s, bench::BACKEND& v) { return bench::from_string(s, v); };
+    const auto parse_scheme = [](std::string_view s, quant::SCHEME& v) { return quant::from_string(s, v); };
+    const auto parse_dynamic_quantization = [](std::string_view s, quant::DYNAMIC_QUANTIZATION& v) { return quant::from_string(s, v); };
+    auto& init = opts.sweep.init;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        const std::string_view value = has_value ? argv[i + 1] : "";
+        bool ok = true;
+        if (arg == "--help" || arg == "-h")
+        {
+            return false;
+        }
+        else if (arg == "--no_cpu")
+        {
+            opts.run_cpu = false;
+            continue;
+        }
+        else if (arg == "--cuda")
+        {
+            opts.run_cuda = true;
+            continue;
+        }
+        else if (arg == "--b_kn")
+        {
+            opts.sweep.b_transposed = false;
+            continue;
+        }
+        else if (arg == "--huge_pages")
+        {
+            opts.sweep.cpu.arena_huge_pages = true;
+            continue;
+        }
+        else if (arg == "--ref_fp64")
+        {
+            opts.reference_fp64 = true;
+            continue;
+        }
+        else if (arg == "--pin")
+        {
+            opts.sweep.cpu.pin_threads = true;
+            continue;
+        }
+        else if (arg == "--numa")
+        {
+            opts.sweep.cpu.numa_aware = true;
+            continue;
+        }
+        else if (arg == "--bias")
+        {
+            opts.sweep.epilogue.bias = true;
+            continue;
+        }
+        else if (arg == "--residual")
+        {
+            opts.sweep.epilogue.residual = true;
+            continue;
+        }
+#if BUILD_CPU
+        else if (arg == "--autotune")
+        {
+            opts.sweep.cpu_autotune = true;
+            continue;
+        }
+#endif
+        else if (!has_value)
+        {
+            ok = false;
+        }
+        else if (arg == "--M")
+        {
+            ok = parse_list(value, opts.sweep.M, parse_u32);
+        }
+        else if (arg == "--K")
+        {
+            ok = parse_list(value, opts.sweep.K, parse_u32);
+        }
+        else if (arg == "--N")
+        {
+            ok = parse_list(value, opts.sweep.N, parse_u32);
+        }
+        else if (arg == "--block_size")
+        {
+            ok = parse_list(value, opts.sweep.block_size, parse_u32);
+        }
+        else if (arg == "--quant")
+        {
+            ok = parse_list(value, opts.sweep.quantization, parse_scheme);
+        }
+        else if (arg == "--a_quant")
+        {
+            ok = parse_list(value, opts.sweep.dynamic_quantization, parse_dynamic_quantization);
+        }
+#if BUILD_CPU
+        else if (arg == "--dequant")
+        {
+            ok = cpu::from_string(value, opts.sweep.cpu_gemm.dequantization);
+        }
+        else if (arg == "--engine")
+        {
+            ok = cpu::from_string(value, opts.sweep.cpu_gemm.engine);
+        }
+        else if (arg == "--tuning_cache")
+        {
+            opts.sweep.cpu_tuning_cache_path = value;
+        }
+#endif
+        else if (arg == "--act")
+        {
+            ok = epilogue::from_string(value, opts.sweep.epilogue.activation);
+        }
+        else if (arg == "--requant")
+        {
+            opts.sweep.epilogue.requantize = true;
+            ok = parse_value(value, opts.sweep.epilogue.output_scale) && opts.sweep.epilogue.output_scale > 0.0f;
+        }
+        else if (arg == "--backend")
+        {
+            ok = parse_list(value, opts.sweep.backends, parse_backend);
+        }
+        else if (arg == "--loop")
+        {
+            ok = parse_value(value, opts.execute_loop);
+        }
+        else if (arg == "--threads")
+        {
+            ok = parse_value(value, opts.sweep.cpu.threads_count);
+        }
+        else if (arg == "--isa")
+        {
+            ok = cpu::from_string(value, opts.sweep.cpu.max_isa);
+        }
+        else if (arg == "--batch")
+        {
+            ok = parse_value(value, opts.sweep.cpu_batch) && opts.sweep.cpu_batch > 0;
+        }
+        else if (arg == "--atol")
+        {
+            ok = parse_value(value, opts.compare.abs_tolerance);
+        }
+        else if (arg == "--rtol")
+        {
+            ok = parse_value(value, opts.compare.rel_tolerance);
+        }
+        else if (arg == "--ulp")
+        {
+            ok = parse_value(value, opts.compare.ulp_tolerance);
+        }
+        else if (arg == "--warmup")
+        {
+            ok = parse_value(value, opts.sweep.warmup_iters);
+        }
+        else if (arg == "--iters")
+        {
+            ok = parse_value(value, opts.sweep.timed_iters) && opts.sweep.timed_iters > 0;
+        }
+        else if (arg == "--stream")
+        {
+            ok = parse_value(value, opts.sweep.stream_elements);
+        }
+        else if (arg == "--seed")
+        {
+            ok = parse_value(value, init.seed);
+        }
+        else if (arg == "--a_init")
+        {
+            ok = cpu::from_string(value, init.a);
+        }
+        else if (arg == "--b_init")
+        {
+            cpu::distribution_t b{};
+            ok = cpu::from_string(value, b);
+            init.b = b;
+        }
+        else if (arg == "--scale_init")
+        {
+            ok = cpu::from_string(value, init.b_scale);
+        }
+        else if (arg == "--zp_init")
+        {
+            ok = cpu::from_string(value, init.b_zero_point);
+        }
+        else if (arg == "--bias_init")
+        {
+            ok = cpu::from_string(value, init.bias);
+        }
+        else if (arg == "--residual_init")
+        {
+            ok = cpu::from_string(value, init.residual);
+        }
+        else if (arg == "--weights")
+        {
+            init.weights_path = value;
+        }
+        else if (arg == "--save_weights")
+        {
+            opts.save_weights_path = value;
+        }
+        else if (arg == "--packed_weights")
+        {
+            opts.packed_weights_path = value;
+        }
+        else if (arg == "--json")
+        {
+            opts.json_path = value;
+        }
+        else if (arg == "--csv")
+        {
+            opts.csv_path = value;
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            std::cout << "[AI_Playground] Invalid argument: " << arg << " " << value << std::endl;
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "ioperator.h"
+#include "benchmark.h"
+
+#include <cstddef>
+#include <filesystem>
+
+// Command line shared by the conformance (AI_Playground) and benchmark (AI_Playground_benchmark) executables.
+struct app_opts_t
+{
+    std::size_t execute_loop = 1;
+    bool run_cpu = true;
+    bool run_cuda = false;
+    bool reference_fp64 = false;
+    op::IOperator::compare_config_t compare{};
+
+    bench::sweep_params_t sweep{};
+    std::filesystem::path json_path{};
+    std::filesystem::path csv_path{};
+    std::filesystem::path save_weights_path{};
+    std::filesystem::path packed_weights_path{};
+};
+
+void print_usage(const char* app_name);
+bool parse_args(int argc, char* argv[], app_opts_t& opts);
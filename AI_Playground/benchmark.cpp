@@ -0,0 +1,368 @@
+#include "benchmark.h"
+
+#include "quantized_gemm.h"
+#include "dx12_context.h"
+#include "cuda_context.h"
+#include "cpu_context.h"
+#include "tensor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <span>
+
+namespace
+{
+// nearest-rank percentile, samples have to be sorted
+double percentile(const std::vector<double>& sorted_samples, double p)
+{
+    assert(!sorted_samples.empty());
+    const auto rank = static_cast<std::size_t>(p / 100.0 * (sorted_samples.size() - 1) + 0.5);
+    return sorted_samples[std::min(rank, sorted_samples.size() - 1)];
+}
+
+std::vector<double> time_iterations(std::size_t warmup_iters, std::size_t timed_iters, const std::function<void()>& fn)
+{
+    for (std::size_t i = 0; i < warmup_iters; i++)
+    {
+        fn();
+    }
+    std::vector<double> samples_ms(timed_iters);
+    for (auto& sample : samples_ms)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+        sample = std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    std::sort(samples_ms.begin(), samples_ms.end());
+    return samples_ms;
+}
+
+double quantized_gemm_bytes(const op::QuantizedGemm::create_params_t& cp)
+{
+    const std::uint64_t blocks = std::uint64_t(cp.N) * (cp.K / quant::get_block_size(cp.quantization, cp.K, cp.block_size));
+    const std::uint64_t zero_points = quant::has_zero_point(cp.quantization) ? blocks : 0;
+    return double(tensor::get_size_in_bytes(tensor::DATA_TYPE_FP16, std::uint64_t(cp.M) * cp.K))  // A
+        + double(tensor::get_size_in_bytes(quant::get_weights_data_type(cp.quantization), std::uint64_t(cp.N) * cp.K))   // B
+        + double(tensor::get_size_in_bytes(tensor::DATA_TYPE_FP16, blocks))                         // scales
+        + double(tensor::get_size_in_bytes(tensor::DATA_TYPE_UINT4, zero_points))                   // zero points
+        + double(tensor::get_size_in_bytes(tensor::DATA_TYPE_FP16, cp.epilogue.bias ? cp.N : 0))    // bias
+        + double(tensor::get_size_in_bytes(tensor::DATA_TYPE_FP16, cp.epilogue.residual ? std::uint64_t(cp.M) * cp.N : 0))  // residual
+        + double(tensor::get_size_in_bytes(epilogue::get_output_data_type(cp.epilogue), std::uint64_t(cp.M) * cp.N));   // output
+}
+}
+
+const char* bench::to_string(BACKEND backend)
+{
+    switch (backend)
+    {
+    case BACKEND_CPU: return "cpu";
+    case BACKEND_DML: return "dml";
+    case BACKEND_CUDA: return "cuda";
+    default: return "unknown";
+    }
+}
+
+bool bench::from_string(std::string_view str, BACKEND& backend)
+{
+    for (auto i = 0; i < BACKEND_COUNT; i++)
+    {
+        if (str == to_string(static_cast<BACKEND>(i)))
+        {
+            backend = static_cast<BACKEND>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+double bench::measure_stream_triad_gbps(const cpu::CpuContext& ctx, std::size_t elements)
+{
+    constexpr std::size_t iters = 10;
+    constexpr double scalar = 3.0;
+    const std::size_t tasks_count = ctx.get_threads_count();
+    const auto task_range = [&](std::size_t task_idx)
+    {
+        return std::make_pair(task_idx * elements / tasks_count, (task_idx + 1) * elements / tasks_count);
+    };
+
+    std::unique_ptr<double[]> a = std::make_unique_for_overwrite<double[]>(elements);
+    std::unique_ptr<double[]> b = std::make_unique_for_overwrite<double[]>(elements);
+    std::unique_ptr<double[]> c = std::make_unique_for_overwrite<double[]>(elements);
+    // initialized with the same split as the timed loop, so pages are first touched by the thread that streams them
+    ctx.parallel_for(tasks_count, [&](std::size_t task_idx, std::uint32_t)
+        {
+            const auto [begin, end] = task_range(task_idx);
+            std::fill(a.get() + begin, a.get() + end, 1.0);
+            std::fill(b.get() + begin, b.get() + end, 2.0);
+            std::fill(c.get() + begin, c.get() + end, 0.0);
+        });
+
+    const auto samples_ms = time_iterations(1, iters, [&]()
+        {
+            ctx.parallel_for(tasks_count, [&](std::size_t task_idx, std::uint32_t)
+                {
+                    const auto [begin, end] = task_range(task_idx);
+                    for (std::size_t i = begin; i < end; i++)
+                    {
+                        a[i] = b[i] + scalar * c[i];
+                    }
+                });
+        });
+    return 3.0 * sizeof(double) * elements / (samples_ms.front() * 1e-3) * 1e-9;
+}
+
+std::vector<bench::result_t> bench::run_quantized_gemm_sweep(const sweep_params_t& params)
+{
+    // contexts are expensive to create, they are shared by the whole sweep. The CPU one also fills the tensors of every backend.
+    const auto cpu_ctx = std::make_unique<cpu::CpuContext>(params.cpu);
+    double stream_gbps = 0.0;
+#if BUILD_CPU
+    if (params.stream_elements != 0 && std::find(params.backends.begin(), params.backends.end(), BACKEND_CPU) != params.backends.end())
+    {
+        stream_gbps = measure_stream_triad_gbps(*cpu_ctx, params.stream_elements);
+        std::cout << "[Benchmark] STREAM triad: " << stream_gbps << " GB/s" << std::endl;
+    }
+#endif
+#if BUILD_DX12
+    std::unique_ptr<dx12::Dx12Context> dx12_ctx{};
+#endif
+#if BUILD_CUDA
+    std::unique_ptr<cuda::CudaContext> cuda_ctx{};
+#endif
+
+    std::vector<result_t> results{};
+    for (const auto backend : params.backends)
+    {
+        for (const auto M : params.M)
+        {
+            for (const auto K : params.K)
+            {
+                for (const auto N : params.N)
+                {
+                    for (const auto block_size : params.block_size)
+                    {
+                        // every scheme with every dynamic quantization of A
+                        for (std::size_t variant = 0; variant < params.quantization.size() * params.dynamic_quantization.size(); variant++)
+                        {
+                            const auto quantization = params.quantization[variant / params.dynamic_quantization.size()];
+                            const auto dynamic_quantization = params.dynamic_quantization[variant % params.dynamic_quantization.size()];
+                            if (!quant::is_per_channel(quantization) && (block_size == 0 || K % block_size != 0))
+                            {
+                                std::cout << "[Benchmark] Skipping K: " << K << ", block_size: " << block_size << ", K has to be a multiple of block_size." << std::endl;
+                                continue;
+                            }
+                            if (dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE && !quant::supports_dynamic_quantization(quantization, K, block_size))
+                            {
+                                std::cout << "[Benchmark] Skipping " << quant::to_string(quantization) << ", block_size: " << block_size << ", no int8 dynamic quantization." << std::endl;
+                                continue;
+                            }
+
+                            op::QuantizedGemm::create_params_t cp{};
+                            cp.M = M;
+                            cp.K = K;
+                            cp.N = N;
+                            cp.block_size = block_size;
+                            cp.b_transposed = params.b_transposed;
+                            cp.quantization = quantization;
+                            cp.dynamic_quantization = dynamic_quantization;
+                            cp.epilogue = params.epilogue;
+                            cp.init = params.init;
+                            cp.cpu_ctx = cpu_ctx.get();
+    #if BUILD_CPU
+                            cp.cpu_tuning_cache_path = params.cpu_tuning_cache_path;
+                            cp.cpu_autotune = params.cpu_autotune;
+    #endif
+                            op::QuantizedGemm gemm(cp);
+
+                            result_t result{};
+                            result.backend = backend;
+                            result.M = M;
+                            result.K = K;
+                            result.N = N;
+                            result.block_size = block_size;
+                            result.quantization = quantization;
+                            result.dynamic_quantization = dynamic_quantization;
+                            result.epilogue = epilogue::to_string(params.epilogue);
+                            result.iters = params.timed_iters;
+
+                            std::function<void()> fn{};
+                            std::vector<std::vector<std::uint16_t>> batch_activations{};
+                            std::vector<std::span<const std::byte>> batch_spans{};
+                            // outputs are allocated once, the timed calls write into them
+                            std::vector<std::byte> output(gemm.get_output_size());
+                            std::vector<std::vector<std::byte>> batch_outputs{};
+                            std::vector<std::span<std::byte>> batch_output_spans{};
+                            switch (backend)
+                            {
+                            case BACKEND_CPU:
+                            {
+    #if BUILD_CPU
+                                result.device = std::string("cpu_") + cpu::to_string(cpu_ctx->get_isa()) + "_" + std::to_string(cpu_ctx->get_threads_count()) + "t";
+                                // batched calls stack the rows of their requests, the config is tuned for what the timed calls run
+                                op::IOperator::execute_cpu_config_t cpu_config{};
+                                cpu_config.rows = M * params.cpu_batch;
+                                gemm.prepare(cpu_ctx.get(), cpu_config);
+                                // shapes without a tuned config run the command line one
+                                if (!gemm.is_cpu_tuned())
+                                {
+                                    gemm.set_cpu_config(params.cpu_gemm);
+                                }
+                                result.tuned = gemm.is_cpu_tuned();
+                                const auto resolved = gemm.resolve_cpu_config(cpu_ctx.get(), M * params.cpu_batch);
+                                result.dequantization = cpu::to_string(resolved.dequantization);
+                                result.engine = cpu::to_string(resolved.engine);
+                                result.mc = resolved.mc;
+                                result.nc_panels = resolved.nc_panels;
+                                result.kc = resolved.kc;
+                                result.threads = resolved.threads;
+                                if (params.cpu_batch > 1)
+                                {
+                                    // fp16 1.0, the values don't matter for timing
+                                    batch_activations.assign(params.cpu_batch, std::vector<std::uint16_t>(std::size_t(M) * K, 0x3c00));
+                                    batch_outputs.assign(params.cpu_batch, output);
+                                    for (std::size_t i = 0; i < params.cpu_batch; i++)
+                                    {
+                                        batch_spans.push_back(std::as_bytes(std::span(batch_activations[i])));
+                                        batch_output_spans.push_back(batch_outputs[i]);
+                                    }
+                                    result.batch = params.cpu_batch;
+                                    fn = [&]() { gemm.run_batched(cpu_ctx.get(), batch_spans, batch_output_spans); };
+                                }
+                                else
+                                {
+                                    fn = [&]() { gemm.run(cpu_ctx.get(), output); };
+                                }
+    #endif
+                                break;
+                            }
+                            case BACKEND_DML:
+                            {
+    #if BUILD_DX12
+                                if (quant::get_lookup_table(quantization) != nullptr)
+                                {
+                                    std::cout << "[Benchmark] DML has no " << quant::to_string(quantization) << " dequantization, skipping." << std::endl;
+                                    continue;
+                                }
+                                if (dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE)
+                                {
+                                    std::cout << "[Benchmark] DML runs fp16 activations only, skipping " << quant::to_string(dynamic_quantization) << " dynamic quantization." << std::endl;
+                                    continue;
+                                }
+                                if (!dx12_ctx)
+                                {
+                                    dx12_ctx = std::make_unique<dx12::Dx12Context>();
+                                }
+                                result.device = "dml";
+                                gemm.prepare(dx12_ctx.get(), op::IOperator::execute_dml_config_t{});
+                                fn = [&]() { gemm.run(dx12_ctx.get(), output); };
+    #endif
+                                break;
+                            }
+                            case BACKEND_CUDA:
+                            {
+    #if BUILD_CUDA
+                                if (!cuda_ctx)
+                                {
+                                    cuda_ctx = std::make_unique<cuda::CudaContext>();
+                                }
+                                result.device = "cuda";
+                                fn = [&]() { gemm.execute(cuda_ctx.get(), op::IOperator::execute_cuda_config_t{ 1 }); };
+    #endif
+                                break;
+                            }
+                            default:
+                                break;
+                            }
+                            if (!fn)
+                            {
+                                std::cout << "[Benchmark] Backend " << to_string(backend) << " is not available in this build, skipping." << std::endl;
+                                continue;
+                            }
+
+                            const auto samples_ms = time_iterations(params.warmup_iters, params.timed_iters, fn);
+                            result.median_ms = percentile(samples_ms, 50.0);
+                            result.p10_ms = percentile(samples_ms, 10.0);
+                            result.p99_ms = percentile(samples_ms, 99.0);
+                            const double seconds = result.median_ms * 1e-3;
+                            auto traffic_cp = cp;
+                            traffic_cp.M = M * result.batch;
+                            result.gflops = 2.0 * double(traffic_cp.M) * N * K / seconds * 1e-9;
+                            result.gbps = quantized_gemm_bytes(traffic_cp) / seconds * 1e-9;
+                            if (backend == BACKEND_CPU && stream_gbps > 0.0)
+                            {
+                                result.stream_fraction = result.gbps / stream_gbps;
+                            }
+                            print_results(std::cout, { result });
+                            results.push_back(result);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return results;
+}
+
+void bench::print_results(std::ostream& os, const std::vector<result_t>& results)
+{
+    const auto flags = os.flags();
+    for (const auto& r : results)
+    {
+        os << "[Benchmark] " << std::left << std::setw(20) << r.device
+            << " M: " << std::setw(6) << r.M << " K: " << std::setw(6) << r.K << " N: " << std::setw(6) << r.N << " block_size: " << std::setw(4) << r.block_size << " quant: " << std::setw(5) << quant::to_string(r.quantization) << " a_quant: " << std::setw(5) << quant::to_string(r.dynamic_quantization) << " epilogue: " << r.epilogue << " dequant: " << std::setw(11) << r.dequantization << " engine: " << std::setw(8) << r.engine
+            << " mc: " << std::setw(4) << r.mc << " nc_panels: " << std::setw(3) << r.nc_panels << " kc: " << std::setw(5) << r.kc << " threads: " << std::setw(3) << r.threads << " tuned: " << std::setw(3) << (r.tuned ? "yes" : "no")
+            << " batch: " << std::setw(4) << r.batch
+            << std::right << std::fixed << std::setprecision(3)
+            << " median: " << std::setw(10) << r.median_ms << " ms"
+            << " p10: " << std::setw(10) << r.p10_ms << " ms"
+            << " p99: " << std::setw(10) << r.p99_ms << " ms"
+            << std::setprecision(1)
+            << " GFLOP/s: " << std::setw(8) << r.gflops
+            << " GB/s: " << std::setw(7) << r.gbps;
+        if (r.stream_fraction > 0.0)
+        {
+            os << " STREAM: " << std::setw(5) << r.stream_fraction * 100.0 << " %";
+        }
+        os << std::endl;
+    }
+    os.flags(flags);
+}
+
+void bench::write_json(const std::filesystem::path& path, const std::vector<result_t>& results)
+{
+    std::ofstream file(path);
+    file << std::setprecision(6) << "[\n";
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const auto& r = results[i];
+        file << "  {"
+            << "\"backend\": \"" << to_string(r.backend) << "\", "
+            << "\"device\": \"" << r.device << "\", "
+            << "\"M\": " << r.M << ", \"K\": " << r.K << ", \"N\": " << r.N << ", \"block_size\": " << r.block_size << ", \"quantization\": \"" << quant::to_string(r.quantization) << "\", \"dynamic_quantization\": \"" << quant::to_string(r.dynamic_quantization) << "\", \"epilogue\": \"" << r.epilogue << "\", \"dequantization\": \"" << r.dequantization << "\", \"engine\": \"" << r.engine << "\", "
+            << "\"mc\": " << r.mc << ", \"nc_panels\": " << r.nc_panels << ", \"kc\": " << r.kc << ", \"threads\": " << r.threads << ", \"tuned\": " << (r.tuned ? "true" : "false") << ", \"batch\": " << r.batch << ", "
+            << "\"iters\": " << r.iters << ", "
+            << "\"median_ms\": " << r.median_ms << ", \"p10_ms\": " << r.p10_ms << ", \"p99_ms\": " << r.p99_ms << ", "
+            << "\"gflops\": " << r.gflops << ", \"gbps\": " << r.gbps << ", \"stream_fraction\": " << r.stream_fraction
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "]\n";
+}
+
+void bench::write_csv(const std::filesystem::path& path, const std::vector<result_t>& results)
+{
+    std::ofstream file(path);
+    file << std::setprecision(6) << "backend,device,M,K,N,block_size,quantization,dynamic_quantization,epilogue,dequantization,engine,mc,nc_panels,kc,threads,tuned,batch,iters,median_ms,p10_ms,p99_ms,gflops,gbps,stream_fraction\n";
+    for (const auto& r : results)
+    {
+        file << to_string(r.backend) << "," << r.device << ","
+            << r.M << "," << r.K << "," << r.N << "," << r.block_size << "," << quant::to_string(r.quantization) << "," << quant::to_string(r.dynamic_quantization) << "," << r.epilogue << "," << r.dequantization << "," << r.engine << "," << r.mc << "," << r.nc_panels << "," << r.kc << "," << r.threads << "," << (r.tuned ? 1 : 0) << "," << r.batch << "," << r.iters << ","
+            << r.median_ms << "," << r.p10_ms << "," << r.p99_ms << "," << r.gflops << "," << r.gbps << "," << r.stream_fraction << "\n";
+    }
+}
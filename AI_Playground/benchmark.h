@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "cpu_context.h"
+#include "quantized_gemm.h"
+
+namespace bench
+{
+enum BACKEND
+{
+    BACKEND_CPU,
+    BACKEND_DML,
+    BACKEND_CUDA,
+    // ..
+    BACKEND_COUNT
+};
+
+const char* to_string(BACKEND backend);
+bool from_string(std::string_view str, BACKEND& backend);
+
+struct sweep_params_t
+{
+    // every combination of the values below is benchmarked
+    std::vector<std::uint32_t> M = { 512 };
+    std::vector<std::uint32_t> K = { 512 };
+    std::vector<std::uint32_t> N = { 512 };
+    std::vector<std::uint32_t> block_size = { 32 };
+    std::vector<quant::SCHEME> quantization = { quant::SCHEME_UINT4_ASYMMETRIC };
+    std::vector<quant::DYNAMIC_QUANTIZATION> dynamic_quantization = { quant::DYNAMIC_QUANTIZATION_NONE };   // of A, schemes without it are skipped
+    bool b_transposed = true;
+    epilogue::desc_t epilogue{};    // of every shape
+    std::vector<BACKEND> backends = { BACKEND_CPU };
+    // tensor contents of every shape, a weights file only fits the sweep entries of its shape
+    op::QuantizedGemm::init_params_t init{};
+
+    // cpu backend: requests of M rows each per QuantizedGemm::run_batched() call, 1 times run()
+    std::uint32_t cpu_batch = 1;
+#if BUILD_CPU
+    // cpu backend: execution choices of every call, e.g. the dequantization and engine
+    cpu::quantized_gemm_config_t cpu_gemm{};
+    // cpu backend: tuned execution choices per shape instead of cpu_gemm, see QuantizedGemm::create_params_t
+    std::filesystem::path cpu_tuning_cache_path{};
+    bool cpu_autotune = false;
+#endif
+
+    std::size_t warmup_iters = 3;
+    std::size_t timed_iters = 20;
+    cpu::CpuContext::create_params_t cpu{};
+    // STREAM arrays should be well past the last level cache, 0 skips the measurement
+    std::size_t stream_elements = std::size_t(1) << 24;
+};
+
+struct result_t
+{
+    BACKEND backend = BACKEND_CPU;
+    std::string device;
+    std::uint32_t M = 0;
+    std::uint32_t K = 0;
+    std::uint32_t N = 0;
+    std::uint32_t block_size = 0;
+    quant::SCHEME quantization = quant::SCHEME_UINT4_ASYMMETRIC;
+    quant::DYNAMIC_QUANTIZATION dynamic_quantization = quant::DYNAMIC_QUANTIZATION_NONE;
+    std::string epilogue = "none";  // epilogue::to_string()
+    // cpu backend: what the calls ran (cpu::to_string())
+    std::string dequantization = "-";
+    std::string engine = "-";
+    std::uint32_t mc = 0;
+    std::uint32_t nc_panels = 0;
+    std::uint32_t kc = 0;
+    std::uint32_t threads = 0;
+    bool tuned = false;         // from the tuning cache or the tuner
+    std::uint32_t batch = 1;    // requests of M rows per call
+    std::size_t iters = 0;
+
+    double median_ms = 0.0;
+    double p10_ms = 0.0;
+    double p99_ms = 0.0;
+    double gflops = 0.0;    // at median
+    double gbps = 0.0;      // at median, compulsory traffic: A, packed B, quantization params, epilogue inputs and output read/written once
+    double stream_fraction = 0.0;   // gbps / STREAM triad bandwidth of the host, cpu backend only
+};
+
+// STREAM triad a[i] = b[i] + q * c[i] over three arrays of fp64, best of a few runs on the context's threads.
+// Bytes are counted the STREAM way (2 reads + 1 write per element, no write allocate).
+double measure_stream_triad_gbps(const cpu::CpuContext& ctx, std::size_t elements);
+
+// Timed iterations measure run() only, prepare() happens once per shape before warmup.
+std::vector<result_t> run_quantized_gemm_sweep(const sweep_params_t& params);
+
+void print_results(std::ostream& os, const std::vector<result_t>& results);
+void write_json(const std::filesystem::path& path, const std::vector<result_t>& results);
+void write_csv(const std::filesystem::path& path, const std::vector<result_t>& results);
+}
@@ -0,0 +1,28 @@
+#include "app_options.h"
+#include "benchmark.h"
+
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    std::cout << "[AI_Playground] starting benchmark." << std::endl;
+    app_opts_t opts{};
+    if (!parse_args(argc, argv, opts))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::cout << "[AI_Playground] Running benchmark sweep." << std::endl;
+    const auto results = bench::run_quantized_gemm_sweep(opts.sweep);
+    if (!opts.json_path.empty())
+    {
+        bench::write_json(opts.json_path, results);
+    }
+    if (!opts.csv_path.empty())
+    {
+        bench::write_csv(opts.csv_path, results);
+    }
+    std::cout << "[AI_Playground] Finished." << std::endl;
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "cpu_arena.h"
+
+#include <cassert>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+inline std::size_t align_up(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+cpu::Arena::Arena(const create_params_t& params)
+    : params_(params)
+{
+    if (params_.initial_size != 0)
+    {
+        add_block(params_.initial_size);
+    }
+}
+
+cpu::Arena::~Arena()
+{
+    free_blocks();
+}
+
+void* cpu::Arena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    alignment = std::max(alignment, CACHE_LINE_SIZE);
+    assert((alignment & (alignment - 1)) == 0);
+    // blocks start on a cache line (or huge page) boundary, larger alignments need the address itself aligned
+    while (block_idx_ < blocks_.size())
+    {
+        const auto base = reinterpret_cast<std::uintptr_t>(blocks_[block_idx_].data);
+        const std::size_t offset = align_up(base + offset_, alignment) - base;
+        if (offset + bytes <= blocks_[block_idx_].size)
+        {
+            offset_ = offset + bytes;
+            return blocks_[block_idx_].data + offset;
+        }
+        block_idx_++;
+        offset_ = 0;
+    }
+    add_block(bytes + alignment);
+    block_idx_ = blocks_.size() - 1;
+    offset_ = 0;
+    return allocate(bytes, alignment);
+}
+
+void cpu::Arena::rewind(const marker_t& marker)
+{
+    assert(marker.block_idx < blocks_.size() || (marker.block_idx == 0 && marker.offset == 0));
+    block_idx_ = marker.block_idx;
+    offset_ = marker.offset;
+    if (block_idx_ == 0 && offset_ == 0 && blocks_.size() > 1)
+    {
+        const std::size_t capacity = get_capacity();
+        free_blocks();
+        add_block(capacity);
+    }
+}
+
+std::size_t cpu::Arena::get_capacity() const
+{
+    std::size_t capacity = 0;
+    for (const auto& block : blocks_)
+    {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+void cpu::Arena::add_block(std::size_t min_size)
+{
+    // geometric growth keeps the number of blocks logarithmic until the next merge
+    const std::size_t alignment = params_.huge_pages ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+    const std::size_t size = align_up(std::max(min_size, get_capacity()), params_.huge_pages ? HUGE_PAGE_SIZE : 4096);
+    auto* data = static_cast<std::byte*>(::operator new(size, std::align_val_t(alignment)));
+#if defined(__linux__)
+    if (params_.huge_pages)
+    {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
+    blocks_.push_back({ data, size });
+}
+
+void cpu::Arena::free_blocks()
+{
+    const std::size_t alignment = params_.huge_pages ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+    for (const auto& block : blocks_)
+    {
+        ::operator delete(block.data, std::align_val_t(alignment));
+    }
+    blocks_.clear();
+}
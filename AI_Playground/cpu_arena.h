@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace cpu
+{
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+
+// Bump allocator for per-call scratch memory. Allocations are uninitialized and only released all at once by rewinding,
+// blocks are kept across calls, so a steady stream of same-sized calls allocates nothing after the first one.
+// Not thread safe: allocate on the calling thread before handing the memory to parallel_for() workers.
+class Arena
+{
+public:
+    struct create_params_t
+    {
+        std::size_t initial_size = 0;   // reserved up front, the arena grows on demand
+        bool huge_pages = false;        // blocks are 2 MB aligned and sized, backed by transparent huge pages on Linux
+    };
+
+    // Position of the bump pointer, rewinding to it releases everything allocated after it was taken.
+    struct marker_t
+    {
+        std::size_t block_idx = 0;
+        std::size_t offset = 0;
+    };
+
+public:
+    Arena(const create_params_t& params);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // alignment is raised to at least CACHE_LINE_SIZE
+    void* allocate(std::size_t bytes, std::size_t alignment = CACHE_LINE_SIZE);
+    template<typename T>
+    std::span<T> allocate(std::size_t count)
+    {
+        return { static_cast<T*>(allocate(count * sizeof(T), std::max(alignof(T), CACHE_LINE_SIZE))), count };
+    }
+
+    marker_t get_marker() const { return { block_idx_, offset_ }; }
+    // Rewinding to the start merges the blocks into one big enough for everything used so far.
+    void rewind(const marker_t& marker);
+    void reset() { rewind(marker_t{}); }
+
+    std::size_t get_capacity() const;
+
+private:
+    struct block_t
+    {
+        std::byte* data = nullptr;
+        std::size_t size = 0;
+    };
+
+    void add_block(std::size_t min_size);
+    void free_blocks();
+
+private:
+    const create_params_t params_;
+    std::vector<block_t> blocks_;
+    std::size_t block_idx_ = 0;
+    std::size_t offset_ = 0;
+};
+
+// Rewinds the arena to where it was at construction, scopes nest.
+class ArenaScope
+{
+public:
+    ArenaScope(Arena& arena)
+        : arena_(arena)
+        , marker_(arena.get_marker())
+    {
+    }
+    ~ArenaScope() { arena_.rewind(marker_); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena& arena_;
+    const Arena::marker_t marker_;
+};
+}
@@ -0,0 +1,177 @@
+#include "cpu_compare.h"
+#include "cpu_context.h"
+#include "float16.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Elements per task, the converted chunk stays in L1.
+constexpr std::size_t CHUNK_SIZE = 4096;
+
+// fp16 bit patterns mapped to integers ordered like the values they encode, so ulp distance is a subtraction
+inline std::int32_t ordered_half(std::uint16_t h)
+{
+    const auto magnitude = static_cast<std::int32_t>(h & 0x7fffu);
+    return (h & 0x8000u) ? -magnitude : magnitude;
+}
+
+inline bool is_half_nan(std::uint16_t h)
+{
+    return (h & 0x7c00u) == 0x7c00u && (h & 0x03ffu) != 0;
+}
+
+struct chunk_result_t
+{
+    std::size_t mismatches_count = 0;
+    double sum_abs_error = 0.0;
+    float max_abs_error = 0.0f;
+    float max_rel_error = 0.0f;
+    std::uint32_t max_ulp_error = 0;
+    std::vector<std::size_t> first_mismatches;
+};
+}
+
+cpu::compare_result_t cpu::compare_fp16(const CpuContext& ctx, std::span<const std::byte> data, std::span<const std::byte> reference,
+    std::size_t rows, std::size_t cols, const compare_params_t& params)
+{
+    const std::size_t elements_count = rows * cols;
+    assert(data.size() >= elements_count * sizeof(std::uint16_t));
+    assert(reference.size() >= elements_count * sizeof(std::uint16_t));
+    const auto* data_f16 = reinterpret_cast<const std::uint16_t*>(data.data());
+    const auto* ref_f16 = reinterpret_cast<const std::uint16_t*>(reference.data());
+
+    const std::size_t chunks_count = (elements_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<chunk_result_t> chunks(chunks_count);
+    ctx.parallel_for(chunks_count, [&](std::size_t chunk_idx, std::uint32_t)
+        {
+            const std::size_t begin = chunk_idx * CHUNK_SIZE;
+            const std::size_t count = std::min(CHUNK_SIZE, elements_count - begin);
+            const std::uint16_t* lhs = data_f16 + begin;
+            const std::uint16_t* rhs = ref_f16 + begin;
+
+            float values[CHUNK_SIZE];
+            float refs[CHUNK_SIZE];
+            fp16::to_float(reinterpret_cast<const fp16::float16_t*>(lhs), values, count);
+            fp16::to_float(reinterpret_cast<const fp16::float16_t*>(rhs), refs, count);
+
+            float abs_error[CHUNK_SIZE];
+            float rel_error[CHUNK_SIZE];
+            std::uint32_t ulp_error[CHUNK_SIZE];
+            for (std::size_t i = 0; i < count; i++)
+            {
+                const float value = values[i];
+                const float ref = refs[i];
+                const bool lhs_nan = is_half_nan(lhs[i]);
+                const bool rhs_nan = is_half_nan(rhs[i]);
+                const bool equal = value == ref || (lhs_nan && rhs_nan);
+                const bool one_nan = lhs_nan != rhs_nan;
+
+                const float err = std::fabs(value - ref);
+                abs_error[i] = equal ? 0.0f : (one_nan || std::isnan(err) ? std::numeric_limits<float>::infinity() : err);
+                rel_error[i] = abs_error[i] == 0.0f ? 0.0f : abs_error[i] / std::fabs(ref);
+                const auto ulp = static_cast<std::uint32_t>(std::abs(ordered_half(lhs[i]) - ordered_half(rhs[i])));
+                ulp_error[i] = equal ? 0u : (one_nan ? std::numeric_limits<std::uint32_t>::max() : ulp);
+            }
+
+            auto& result = chunks[chunk_idx];
+            for (std::size_t i = 0; i < count; i++)
+            {
+                const bool match = abs_error[i] <= params.abs_tolerance
+                    || rel_error[i] <= params.rel_tolerance
+                    || ulp_error[i] <= params.ulp_tolerance;
+                result.mismatches_count += match ? 0 : 1;
+                result.sum_abs_error += abs_error[i];
+                result.max_abs_error = std::max(result.max_abs_error, abs_error[i]);
+                result.max_rel_error = std::max(result.max_rel_error, rel_error[i]);
+                result.max_ulp_error = std::max(result.max_ulp_error, ulp_error[i]);
+            }
+            for (std::size_t i = 0; i < count && result.first_mismatches.size() < std::min(result.mismatches_count, params.max_reported_mismatches); i++)
+            {
+                if (!(abs_error[i] <= params.abs_tolerance || rel_error[i] <= params.rel_tolerance || ulp_error[i] <= params.ulp_tolerance))
+                {
+                    result.first_mismatches.push_back(begin + i);
+                }
+            }
+        });
+
+    compare_result_t ret{};
+    ret.elements_count = elements_count;
+    double sum_abs_error = 0.0;
+    for (const auto& chunk : chunks)
+    {
+        ret.mismatches_count += chunk.mismatches_count;
+        sum_abs_error += chunk.sum_abs_error;
+        ret.max_abs_error = std::max<double>(ret.max_abs_error, chunk.max_abs_error);
+        ret.max_rel_error = std::max<double>(ret.max_rel_error, chunk.max_rel_error);
+        ret.max_ulp_error = std::max(ret.max_ulp_error, chunk.max_ulp_error);
+        for (const auto idx : chunk.first_mismatches)
+        {
+            if (ret.first_mismatches.size() < params.max_reported_mismatches)
+            {
+                ret.first_mismatches.push_back({ idx / cols, idx % cols, fp16::to_float(fp16::float16_t{ data_f16[idx] }), fp16::to_float(fp16::float16_t{ ref_f16[idx] }) });
+            }
+        }
+    }
+    ret.mean_abs_error = elements_count ? sum_abs_error / elements_count : 0.0;
+    ret.passed = ret.mismatches_count == 0;
+    return ret;
+}
+
+cpu::compare_result_t cpu::compare_int8(const CpuContext& ctx, std::span<const std::byte> data, std::span<const std::byte> reference,
+    std::size_t rows, std::size_t cols, const compare_params_t& params)
+{
+    const std::size_t elements_count = rows * cols;
+    assert(data.size() >= elements_count);
+    assert(reference.size() >= elements_count);
+    const auto* data_i8 = reinterpret_cast<const std::int8_t*>(data.data());
+    const auto* ref_i8 = reinterpret_cast<const std::int8_t*>(reference.data());
+
+    const std::size_t chunks_count = (elements_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<chunk_result_t> chunks(chunks_count);
+    ctx.parallel_for(chunks_count, [&](std::size_t chunk_idx, std::uint32_t)
+        {
+            const std::size_t begin = chunk_idx * CHUNK_SIZE;
+            const std::size_t count = std::min(CHUNK_SIZE, elements_count - begin);
+            auto& result = chunks[chunk_idx];
+            for (std::size_t i = begin; i < begin + count; i++)
+            {
+                const auto steps = static_cast<std::uint32_t>(std::abs(int(data_i8[i]) - int(ref_i8[i])));
+                const bool match = float(steps) <= params.abs_tolerance;
+                result.mismatches_count += match ? 0 : 1;
+                result.sum_abs_error += steps;
+                result.max_abs_error = std::max(result.max_abs_error, float(steps));
+                result.max_rel_error = std::max(result.max_rel_error, steps == 0 ? 0.0f : float(steps) / std::max(1, std::abs(int(ref_i8[i]))));
+                result.max_ulp_error = std::max(result.max_ulp_error, steps);
+                if (!match && result.first_mismatches.size() < params.max_reported_mismatches)
+                {
+                    result.first_mismatches.push_back(i);
+                }
+            }
+        });
+
+    compare_result_t ret{};
+    ret.elements_count = elements_count;
+    double sum_abs_error = 0.0;
+    for (const auto& chunk : chunks)
+    {
+        ret.mismatches_count += chunk.mismatches_count;
+        sum_abs_error += chunk.sum_abs_error;
+        ret.max_abs_error = std::max<double>(ret.max_abs_error, chunk.max_abs_error);
+        ret.max_rel_error = std::max<double>(ret.max_rel_error, chunk.max_rel_error);
+        ret.max_ulp_error = std::max(ret.max_ulp_error, chunk.max_ulp_error);
+        for (const auto idx : chunk.first_mismatches)
+        {
+            if (ret.first_mismatches.size() < params.max_reported_mismatches)
+            {
+                ret.first_mismatches.push_back({ idx / cols, idx % cols, float(data_i8[idx]), float(ref_i8[idx]) });
+            }
+        }
+    }
+    ret.mean_abs_error = elements_count ? sum_abs_error / elements_count : 0.0;
+    ret.passed = ret.mismatches_count == 0;
+    return ret;
+}
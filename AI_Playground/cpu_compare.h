@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace cpu
+{
+class CpuContext;
+
+// An element matches when it is within any of the tolerances, all zeros means bitwise equal values (+0 == -0, NaN == NaN).
+struct compare_params_t
+{
+    float abs_tolerance = 0.0f;
+    float rel_tolerance = 0.0f;             // relative to |reference|
+    std::uint32_t ulp_tolerance = 0;        // distance in fp16 units in the last place
+    std::size_t max_reported_mismatches = 10;
+};
+
+struct compare_mismatch_t
+{
+    std::size_t m = 0;
+    std::size_t n = 0;
+    float value = 0.0f;
+    float reference = 0.0f;
+};
+
+struct compare_result_t
+{
+    bool passed = true;
+    std::size_t elements_count = 0;
+    std::size_t mismatches_count = 0;
+    double max_abs_error = 0.0;
+    double max_rel_error = 0.0;
+    double mean_abs_error = 0.0;
+    std::uint32_t max_ulp_error = 0;
+    std::vector<compare_mismatch_t> first_mismatches;   // in row-major order, at most max_reported_mismatches
+};
+
+// Compares two row-major [rows, cols] fp16 tensors element-wise, chunks are checked in parallel on the context's threads.
+compare_result_t compare_fp16(const CpuContext& ctx, std::span<const std::byte> data, std::span<const std::byte> reference,
+    std::size_t rows, std::size_t cols, const compare_params_t& params);
+
+// Same for int8 tensors, the errors are in quantization steps: abs_tolerance applies, rel_tolerance and ulp_tolerance are ignored
+// and max_ulp_error reports the largest step distance.
+compare_result_t compare_int8(const CpuContext& ctx, std::span<const std::byte> data, std::span<const std::byte> reference,
+    std::size_t rows, std::size_t cols, const compare_params_t& params);
+}
@@ -0,0 +1,29 @@
+#include "cpu_context.h"
+#include "cpu_arena.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+
+cpu::CpuContext::CpuContext()
+    : CpuContext(create_params_t{})
+{
+}
+
+cpu::CpuContext::CpuContext(const create_params_t& params)
+    : isa_(std::min(detect_isa(), params.max_isa))
+    , thread_pool_(std::make_unique<ThreadPool>(ThreadPool::create_params_t{ params.threads_count, params.pin_threads, params.numa_aware }))
+    , arena_(std::make_unique<Arena>(Arena::create_params_t{ params.arena_size, params.arena_huge_pages }))
+{
+}
+
+cpu::CpuContext::~CpuContext() = default;
+
+std::uint32_t cpu::CpuContext::get_threads_count() const
+{
+    return thread_pool_->get_threads_count();
+}
+
+void cpu::CpuContext::parallel_for(std::size_t tasks_count, const std::function<void(std::size_t, std::uint32_t)>& fn) const
+{
+    thread_pool_->parallel_for(tasks_count, fn);
+}
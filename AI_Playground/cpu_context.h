@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "cpu_isa.h"
+
+namespace cpu
+{
+class Arena;
+class ThreadPool;
+
+class CpuContext
+{
+public:
+    struct create_params_t
+    {
+        std::uint32_t threads_count = 0;    // 0 means use all hardware threads
+        ISA max_isa = ISA_AVX512_VNNI;      // caps the detected ISA, ex. to compare kernels on the same machine
+        bool pin_threads = false;
+        bool numa_aware = false;            // see ThreadPool
+        std::size_t arena_size = 0;         // scratch arena reserved up front, see Arena
+        bool arena_huge_pages = false;
+    };
+
+public:
+    CpuContext();
+    CpuContext(const create_params_t& params);
+    ~CpuContext();
+
+    std::uint32_t get_threads_count() const;
+    ISA get_isa() const { return isa_; }
+
+    // Runs fn(task_idx, thread_idx) for every task_idx in [0, tasks_count) on the context's thread pool.
+    void parallel_for(std::size_t tasks_count, const std::function<void(std::size_t, std::uint32_t)>& fn) const;
+
+    // Scratch memory of the calls running on this context, take an ArenaScope around the allocations.
+    // Calls sharing a context have to be serialized.
+    Arena& get_arena() const { return *arena_; }
+
+private:
+    ISA isa_ = ISA_SCALAR;
+    std::unique_ptr<ThreadPool> thread_pool_;
+    std::unique_ptr<Arena> arena_;
+};
+}
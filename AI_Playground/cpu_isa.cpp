@@ -0,0 +1,145 @@
+#include "cpu_isa.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CPU_ISA_X86_64 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if CPU_ISA_X86_64
+std::array<std::uint32_t, 4> cpuid(std::uint32_t leaf, std::uint32_t subleaf)
+{
+    std::array<std::uint32_t, 4> regs{};
+#if defined(_MSC_VER)
+    int out[4]{};
+    __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (auto i = 0; i < 4; i++)
+    {
+        regs[i] = static_cast<std::uint32_t>(out[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    return regs;
+}
+
+std::uint64_t xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    std::uint32_t eax = 0;
+    std::uint32_t edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (std::uint64_t(edx) << 32) | eax;
+#endif
+}
+
+inline bool has_bit(std::uint32_t reg, std::uint32_t bit)
+{
+    return (reg >> bit) & 1u;
+}
+#endif  // #if CPU_ISA_X86_64
+}
+
+cpu::ISA cpu::detect_isa()
+{
+#if CPU_ISA_X86_64
+    const auto max_leaf = cpuid(0, 0)[0];
+    if (max_leaf < 7)
+    {
+        return ISA_SCALAR;
+    }
+    const auto leaf1 = cpuid(1, 0);
+    const auto leaf7 = cpuid(7, 0);
+
+    // OS has to save ymm (and zmm/opmask for AVX-512) state on context switch.
+    const bool osxsave = has_bit(leaf1[2], 27);
+    const auto xcr0 = osxsave ? xgetbv0() : 0;
+    const bool os_avx = (xcr0 & 0x6) == 0x6;
+    const bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+    const bool avx2 = os_avx
+        && has_bit(leaf1[2], 28)    // AVX
+        && has_bit(leaf1[2], 12)    // FMA
+        && has_bit(leaf1[2], 29)    // F16C
+        && has_bit(leaf7[1], 5);    // AVX2
+    if (!avx2)
+    {
+        return ISA_SCALAR;
+    }
+
+    const bool avx512 = os_avx512
+        && has_bit(leaf7[1], 16)    // AVX512F
+        && has_bit(leaf7[1], 17)    // AVX512DQ
+        && has_bit(leaf7[1], 30)    // AVX512BW
+        && has_bit(leaf7[1], 31);   // AVX512VL
+    if (!avx512)
+    {
+        return ISA_AVX2;
+    }
+    return has_bit(leaf7[2], 11) ? ISA_AVX512_VNNI : ISA_AVX512;
+#else
+    return ISA_SCALAR;
+#endif
+}
+
+const char* cpu::to_string(ISA isa)
+{
+    switch (isa)
+    {
+    case ISA_SCALAR: return "scalar";
+    case ISA_AVX2: return "avx2";
+    case ISA_AVX512: return "avx512";
+    case ISA_AVX512_VNNI: return "avx512_vnni";
+    default: return "unknown";
+    }
+}
+
+bool cpu::from_string(std::string_view str, ISA& isa)
+{
+    for (int i = 0; i < ISA_COUNT; i++)
+    {
+        if (str == to_string(static_cast<ISA>(i)))
+        {
+            isa = static_cast<ISA>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string cpu::get_cpu_model()
+{
+#if CPU_ISA_X86_64
+    if (cpuid(0x80000000, 0)[0] < 0x80000004)
+    {
+        return "unknown";
+    }
+    // 48 bytes over three leaves, nul padded and often space padded too
+    char brand[49]{};
+    for (std::uint32_t i = 0; i < 3; i++)
+    {
+        const auto regs = cpuid(0x80000002 + i, 0);
+        std::memcpy(brand + i * 16, regs.data(), 16);
+    }
+    std::string ret(brand);
+    const auto begin = ret.find_first_not_of(' ');
+    if (begin == std::string::npos)
+    {
+        return "unknown";
+    }
+    return ret.substr(begin, ret.find_last_not_of(' ') - begin + 1);
+#else
+    return "unknown";
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace cpu
+{
+// Ordered, each level implies all previous ones.
+enum ISA
+{
+    ISA_SCALAR,
+    ISA_AVX2,           // AVX2 + FMA + F16C
+    ISA_AVX512,         // AVX-512 F/BW/VL/DQ
+    ISA_AVX512_VNNI,
+    // ..
+    ISA_COUNT
+};
+
+ISA detect_isa();
+const char* to_string(ISA isa);
+// "scalar", "avx2", "avx512" or "avx512_vnni"
+bool from_string(std::string_view str, ISA& isa);
+
+// Brand string of the processor, ex. "AMD EPYC 9654 96-Core Processor", "unknown" when it can't be read.
+std::string get_cpu_model();
+}
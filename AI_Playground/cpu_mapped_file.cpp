@@ -0,0 +1,106 @@
+#include "cpu_mapped_file.h"
+
+#include <iostream>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+cpu::MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+{
+}
+
+cpu::MappedFile& cpu::MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+cpu::MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool cpu::MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+    std::error_code ec{};
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec || size == 0)
+    {
+        std::cerr << "[MappedFile] " << path << ": can't map, " << (ec ? ec.message() : "empty file") << std::endl;
+        return false;
+    }
+
+#if defined(_WIN32)
+    // the view keeps the mapping alive, both handles can be closed right away
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "[MappedFile] " << path << ": can't open, error " << GetLastError() << std::endl;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        std::cerr << "[MappedFile] " << path << ": can't map, error " << GetLastError() << std::endl;
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+    {
+        std::cerr << "[MappedFile] " << path << ": can't map, error " << GetLastError() << std::endl;
+        return false;
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "[MappedFile] " << path << ": can't open." << std::endl;
+        return false;
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::cerr << "[MappedFile] " << path << ": can't map." << std::endl;
+        return false;
+    }
+#endif
+    data_ = static_cast<const std::byte*>(data);
+    size_ = static_cast<std::size_t>(size);
+    return true;
+}
+
+void cpu::MappedFile::close()
+{
+    if (!data_)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<std::byte*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
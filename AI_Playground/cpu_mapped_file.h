@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace cpu
+{
+// Read-only memory mapping of a whole file. Pages are loaded on first access and shared through the page cache
+// with every process mapping the same file, nothing is copied to the heap.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    // Returns false and prints the reason on failure, the previous mapping is released either way.
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    std::span<const std::byte> get_data() const { return { data_, size_ }; }
+
+private:
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+}
@@ -0,0 +1,197 @@
+#include "cpu_packed_weights_file.h"
+#include "cpu_context.h"
+#include "cpu_mapped_file.h"
+#include "cpu_quantized_gemm_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+// Bytes per checksum task.
+constexpr std::size_t CHECKSUM_CHUNK_SIZE = std::size_t(1) << 20;
+
+inline std::uint64_t rotl(std::uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// splitmix64 finalizer
+inline std::uint64_t mix(std::uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// four independent lanes of 8 byte words keep the multiplies pipelined
+std::uint64_t hash_chunk(const std::byte* data, std::size_t size)
+{
+    constexpr std::uint64_t prime = 0x9e3779b97f4a7c15ull;
+    std::uint64_t lanes[4] = { 1, 2, 3, 4 };
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (std::size_t l = 0; l < 4; l++)
+        {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + i + l * 8, sizeof(word));
+            lanes[l] = rotl((lanes[l] ^ word) * prime, 31);
+        }
+    }
+    for (; i < size; i += 8)
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + i, std::min<std::size_t>(8, size - i));
+        lanes[0] = rotl((lanes[0] ^ word) * prime, 31);
+    }
+    return mix(lanes[0] ^ rotl(lanes[1], 16) ^ rotl(lanes[2], 32) ^ rotl(lanes[3], 48) ^ size);
+}
+
+inline std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+std::uint64_t cpu::checksum(const CpuContext& ctx, std::span<const std::byte> data, std::uint64_t seed)
+{
+    const std::size_t chunks_count = (data.size() + CHECKSUM_CHUNK_SIZE - 1) / CHECKSUM_CHUNK_SIZE;
+    std::vector<std::uint64_t> chunks(chunks_count);
+    ctx.parallel_for(chunks_count, [&](std::size_t chunk_idx, std::uint32_t)
+        {
+            const std::size_t begin = chunk_idx * CHECKSUM_CHUNK_SIZE;
+            chunks[chunk_idx] = hash_chunk(data.data() + begin, std::min(CHECKSUM_CHUNK_SIZE, data.size() - begin));
+        });
+
+    std::uint64_t hash = mix(seed ^ data.size());
+    for (const auto chunk : chunks)
+    {
+        hash = mix(hash ^ chunk);
+    }
+    return hash;
+}
+
+bool cpu::write_packed_weights_file(const CpuContext& ctx, const std::filesystem::path& path, const quantized_gemm_weights_t& weights,
+    std::uint64_t source_checksum)
+{
+    packed_weights_file_header_t header{};
+    header.K = weights.K;
+    header.N = weights.N;
+    header.block_size = weights.block_size;
+    header.b_transposed = weights.b_transposed ? 1 : 0;
+    header.quantization = weights.quantization;
+    header.panel_block_size = weights.panel_block_size;
+    header.isa = ctx.get_isa();
+    header.panel_width = kernels::PANEL_WIDTH;
+    header.dynamic_quantization = weights.dynamic_quantization;
+    header.panel_stride = weights.panel_stride;
+    header.packed_offset = align_up(sizeof(header), PACKED_WEIGHTS_FILE_ALIGNMENT);
+    header.packed_size = weights.packed_size;
+    header.source_checksum = source_checksum;
+    header.packed_checksum = checksum(ctx, weights.packed);
+
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        static const char zeros[PACKED_WEIGHTS_FILE_ALIGNMENT]{};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(zeros, header.packed_offset - sizeof(header));
+        file.write(reinterpret_cast<const char*>(weights.packed.data()), weights.packed_size);
+        if (!file)
+        {
+            std::cerr << "[PackedWeights] " << tmp_path << ": write failed." << std::endl;
+            return false;
+        }
+    }
+    std::error_code ec{};
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        std::cerr << "[PackedWeights] " << path << ": can't replace, " << ec.message() << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool cpu::map_packed_weights_file(const CpuContext& ctx, const std::filesystem::path& path, const quantized_gemm_desc_t& desc,
+    std::uint64_t source_checksum, MappedFile& file, quantized_gemm_weights_t& weights)
+{
+    if (!file.open(path))
+    {
+        return false;
+    }
+    const auto data = file.get_data();
+
+    packed_weights_file_header_t header{};
+    const packed_weights_file_header_t expected{};
+    if (data.size() < sizeof(header) || std::memcmp(data.data(), expected.magic, sizeof(expected.magic)) != 0)
+    {
+        std::cerr << "[PackedWeights] " << path << ": not a packed weights file." << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version != PACKED_WEIGHTS_FILE_VERSION || header.header_size != sizeof(header))
+    {
+        std::cerr << "[PackedWeights] " << path << ": unsupported version " << header.version << ", expected " << PACKED_WEIGHTS_FILE_VERSION << "." << std::endl;
+        return false;
+    }
+    const std::uint32_t block_size = quant::get_block_size(desc.quantization, desc.K, desc.block_size);
+    if (header.K != desc.K || header.N != desc.N || header.block_size != block_size || header.b_transposed != (desc.b_transposed ? 1u : 0u)
+        || header.quantization != static_cast<std::uint32_t>(desc.quantization) || header.dynamic_quantization != static_cast<std::uint32_t>(desc.dynamic_quantization))
+    {
+        std::cerr << "[PackedWeights] " << path << ": packed for K: " << header.K << ", N: " << header.N << ", block_size: " << header.block_size
+            << ", b_transposed: " << header.b_transposed << ", quantization: " << (header.quantization < quant::SCHEME_COUNT ? quant::to_string(static_cast<quant::SCHEME>(header.quantization)) : "unknown")
+            << ", dynamic quantization: " << (header.dynamic_quantization < quant::DYNAMIC_QUANTIZATION_COUNT ? quant::to_string(static_cast<quant::DYNAMIC_QUANTIZATION>(header.dynamic_quantization)) : "unknown")
+            << ", expected K: " << desc.K << ", N: " << desc.N << ", block_size: " << block_size
+            << ", b_transposed: " << desc.b_transposed << ", quantization: " << quant::to_string(desc.quantization)
+            << ", dynamic quantization: " << quant::to_string(desc.dynamic_quantization) << "." << std::endl;
+        return false;
+    }
+    if (header.panel_width != kernels::PANEL_WIDTH || header.panel_block_size != get_panel_block_size(desc) || header.panel_stride != get_panel_stride(desc)
+        || header.packed_size != (header.N + kernels::PANEL_WIDTH - 1) / kernels::PANEL_WIDTH * header.panel_stride)
+    {
+        std::cerr << "[PackedWeights] " << path << ": panel layout doesn't match the kernels." << std::endl;
+        return false;
+    }
+    if (header.isa >= ISA_COUNT || header.isa > static_cast<std::uint32_t>(ctx.get_isa()))
+    {
+        std::cerr << "[PackedWeights] " << path << ": packed for ISA " << (header.isa < ISA_COUNT ? to_string(static_cast<ISA>(header.isa)) : "unknown")
+            << ", the context runs " << to_string(ctx.get_isa()) << "." << std::endl;
+        return false;
+    }
+    if (source_checksum != 0 && header.source_checksum != source_checksum)
+    {
+        std::cerr << "[PackedWeights] " << path << ": packed from different weights." << std::endl;
+        return false;
+    }
+    if (header.packed_offset % PACKED_WEIGHTS_FILE_ALIGNMENT != 0 || header.packed_offset > data.size() || header.packed_size > data.size() - header.packed_offset)
+    {
+        std::cerr << "[PackedWeights] " << path << ": truncated or misaligned panels." << std::endl;
+        return false;
+    }
+    const auto packed = data.subspan(header.packed_offset, header.packed_size);
+    if (checksum(ctx, packed) != header.packed_checksum)
+    {
+        std::cerr << "[PackedWeights] " << path << ": checksum mismatch, the file is corrupted." << std::endl;
+        return false;
+    }
+
+    weights = quantized_gemm_weights_t{};
+    weights.K = header.K;
+    weights.N = header.N;
+    weights.block_size = header.block_size;
+    weights.b_transposed = header.b_transposed != 0;
+    weights.quantization = desc.quantization;
+    weights.dynamic_quantization = desc.dynamic_quantization;
+    weights.panel_block_size = header.panel_block_size;
+    weights.panel_stride = header.panel_stride;
+    weights.packed_size = header.packed_size;
+    weights.packed = packed;
+    return true;
+}
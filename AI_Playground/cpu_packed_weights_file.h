@@ -0,0 +1,57 @@
+#pragma once
+#include "cpu_isa.h"
+#include "cpu_quantized_gemm.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace cpu
+{
+class MappedFile;
+
+// B already repacked in the kernels' panel layout (cpu_quantized_gemm_kernels.h), mapped and used in place instead of packing at startup.
+// The panels start on a PACKED_WEIGHTS_FILE_ALIGNMENT boundary, integers are little endian.
+constexpr std::uint32_t PACKED_WEIGHTS_FILE_VERSION = 3;
+constexpr std::size_t PACKED_WEIGHTS_FILE_ALIGNMENT = 4096;
+
+struct packed_weights_file_header_t
+{
+    char magic[8] = { 'A', 'I', 'P', 'G', 'P', 'A', 'C', 'K' };
+    std::uint32_t version = PACKED_WEIGHTS_FILE_VERSION;
+    std::uint32_t header_size = sizeof(packed_weights_file_header_t);
+
+    std::uint32_t K = 0;
+    std::uint32_t N = 0;
+    std::uint32_t block_size = 0;
+    std::uint32_t b_transposed = 1;     // layout of the source B the panels were built from
+    std::uint32_t quantization = 0;     // quant::SCHEME
+    std::uint32_t panel_block_size = 0; // rows of B per panel record
+
+    std::uint32_t isa = ISA_SCALAR;     // cpu::ISA of the packing context, files needing more than the loading context are rejected
+    std::uint32_t panel_width = 0;      // kernels::PANEL_WIDTH
+    std::uint32_t dynamic_quantization = 0; // quant::DYNAMIC_QUANTIZATION, the integer kernels have their own q row layout
+    std::uint32_t reserved = 0;
+
+    std::uint64_t panel_stride = 0;
+    std::uint64_t packed_offset = 0;
+    std::uint64_t packed_size = 0;
+
+    std::uint64_t source_checksum = 0;  // of the unpacked B, scales and zero points, 0 if unknown
+    std::uint64_t packed_checksum = 0;  // of the panels
+};
+
+// Order dependent 64 bit hash, chunks are hashed in parallel on the context's threads.
+// Not cryptographic, it catches corrupted files and panels packed from different weights. seed chains several buffers.
+std::uint64_t checksum(const CpuContext& ctx, std::span<const std::byte> data, std::uint64_t seed = 0);
+
+// Both return false and print the reason on failure.
+// The file is written next to path and renamed over it, so processes mapping the previous file keep valid pages.
+bool write_packed_weights_file(const CpuContext& ctx, const std::filesystem::path& path, const quantized_gemm_weights_t& weights,
+    std::uint64_t source_checksum);
+// Checks the header against desc, the context's ISA and source_checksum (skipped when 0), then verifies the panels.
+// On success weights.packed points into the file's mapping and is valid as long as it stays open.
+bool map_packed_weights_file(const CpuContext& ctx, const std::filesystem::path& path, const quantized_gemm_desc_t& desc,
+    std::uint64_t source_checksum, MappedFile& file, quantized_gemm_weights_t& weights);
+}
@@ -0,0 +1,955 @@
+#include "cpu_quantized_gemm.h"
+#include "cpu_arena.h"
+#include "cpu_context.h"
+#include "cpu_quantized_gemm_kernels.h"
+#include "float16.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+// Work is split into MC x (NC_PANELS * PANEL_WIDTH) output tiles, K is walked KC at a time:
+// the MC x KC slice of A stays in L2 and the KC rows of a panel stay in L1 while the microkernels walk the tile rows.
+constexpr std::size_t MC = 64;
+constexpr std::size_t NC_PANELS = 4;
+constexpr std::size_t KC = 256;
+
+inline std::uint8_t get_uint4(const std::uint8_t* data, std::size_t idx)
+{
+    const auto byte = data[idx / 2];
+    return (idx & 1) ? (byte >> 4) : (byte & 0x0f);
+}
+
+// column j of a panel row lives in byte j % 8, high nibble for j >= 8
+inline void set_panel_uint4(std::uint8_t* row, std::size_t col, std::uint8_t value)
+{
+    constexpr auto half_width = cpu::kernels::PANEL_WIDTH / 2;
+    auto& byte = row[col % half_width];
+    byte = (col >= half_width) ? ((byte & 0x0f) | (value << 4)) : ((byte & 0xf0) | value);
+}
+
+// (row kk, column col) of a record's q rows in the layout of the integer kernels (see DOT_GROUP), offset to unsigned
+inline void set_dot_value(std::uint8_t* q, cpu::kernels::WEIGHTS_FORMAT format, std::size_t kk, std::size_t col, std::uint8_t value)
+{
+    using namespace cpu::kernels;
+    const std::size_t group = kk / DOT_GROUP;
+    const std::size_t r = kk % DOT_GROUP;
+    const auto offset_value = static_cast<std::uint8_t>(value + dot_offset(format));
+    if (format == WEIGHTS_FORMAT_INT8)
+    {
+        q[group * DOT_GROUP * PANEL_WIDTH + col * DOT_GROUP + r] = offset_value;
+        return;
+    }
+    constexpr auto half_width = PANEL_WIDTH / 2;
+    auto& byte = q[group * DOT_GROUP * PANEL_ROW_BYTES + (col % half_width) * DOT_GROUP + r];
+    const std::uint8_t nibble = offset_value & 0x0f;
+    byte = (col >= half_width) ? ((byte & 0x0f) | (nibble << 4)) : ((byte & 0xf0) | nibble);
+}
+
+cpu::kernels::WEIGHTS_FORMAT get_weights_format(quant::SCHEME scheme)
+{
+    switch (scheme)
+    {
+    case quant::SCHEME_INT4_SYMMETRIC: return cpu::kernels::WEIGHTS_FORMAT_INT4;
+    case quant::SCHEME_INT8_PER_CHANNEL: return cpu::kernels::WEIGHTS_FORMAT_INT8;
+    case quant::SCHEME_NF4:
+    case quant::SCHEME_FP4: return cpu::kernels::WEIGHTS_FORMAT_LUT4;
+    default: return cpu::kernels::WEIGHTS_FORMAT_UINT4_ZERO_POINT;
+    }
+}
+
+cpu::kernels::ACTIVATION get_activation(epilogue::ACTIVATION activation)
+{
+    switch (activation)
+    {
+    case epilogue::ACTIVATION_GELU: return cpu::kernels::ACTIVATION_GELU;
+    case epilogue::ACTIVATION_SILU: return cpu::kernels::ACTIVATION_SILU;
+    default: return cpu::kernels::ACTIVATION_NONE;
+    }
+}
+
+// Scalar post-ops of the N - n0 valid columns of a finished row, shared by the scalar kernel and the split K reduction.
+void store_output_row(const cpu::kernels::epilogue_args_t& args, std::size_t m, std::size_t n0, const float* row)
+{
+    using namespace cpu::kernels;
+    const std::size_t columns = std::min(PANEL_WIDTH, args.N - n0);
+    float values[PANEL_WIDTH];
+    for (std::size_t j = 0; j < columns; j++)
+    {
+        float x = row[j] + (args.bias ? args.bias[n0 + j] : 0.0f);
+        switch (args.activation)
+        {
+        case ACTIVATION_GELU: x = epilogue::activate(epilogue::ACTIVATION_GELU, x); break;
+        case ACTIVATION_SILU: x = epilogue::activate(epilogue::ACTIVATION_SILU, x); break;
+        default: break;
+        }
+        values[j] = x + (args.residual_rows ? fp16::to_float(fp16::float16_t{ args.residual_rows[m][n0 + j] }) : 0.0f);
+    }
+    if (args.requantize)
+    {
+        auto* out = static_cast<std::int8_t*>(args.out_rows[m]) + n0;
+        for (std::size_t j = 0; j < columns; j++)
+        {
+            out[j] = static_cast<std::int8_t>(std::clamp(std::nearbyint(values[j] * args.output_scale_inv), -128.0f, 127.0f));
+        }
+    }
+    else
+    {
+        fp16::from_float(values, static_cast<fp16::float16_t*>(args.out_rows[m]) + n0, columns);
+    }
+}
+
+// Packs B columns [panel * PANEL_WIDTH, panel * PANEL_WIDTH + PANEL_WIDTH) into the panel layout of format,
+// the q rows in the layout of the integer kernels with dynamically quantized activations.
+// B_TRANSPOSED: B is [N, K] and the quantization params [N, K / block_size], otherwise [K, N] and [K / block_size, N].
+template<bool B_TRANSPOSED>
+void pack_panel(const cpu::quantized_gemm_weights_t& weights, cpu::kernels::WEIGHTS_FORMAT format,
+    const std::uint8_t* b_data, const std::uint16_t* scale_f16, const std::uint8_t* zp_u4, std::size_t panel, std::uint8_t* record)
+{
+    using namespace cpu::kernels;
+    const std::size_t K = weights.K;
+    const std::size_t N = weights.N;
+    const std::size_t blocks_count = K / weights.block_size;
+    const std::size_t panel_block_size = weights.panel_block_size;
+    const std::size_t row_bytes = panel_row_bytes(format);
+    const std::size_t n0 = panel * PANEL_WIDTH;
+    const std::size_t columns = std::min(PANEL_WIDTH, N - n0);  // padding stays zero
+    const bool dot_layout = weights.dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE;
+    for (std::size_t k0 = 0; k0 < K; k0 += panel_block_size, record += panel_block_bytes(panel_block_size, format))
+    {
+        const std::size_t blk = k0 / weights.block_size;
+        auto* scale = reinterpret_cast<std::uint16_t*>(record);
+        for (std::size_t j = 0; j < columns; j++)
+        {
+            const std::size_t qp_idx = B_TRANSPOSED ? (n0 + j) * blocks_count + blk : blk * N + n0 + j;
+            scale[j] = scale_f16[qp_idx];
+            if (format == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+            {
+                set_panel_uint4(record + PANEL_ZERO_POINT_OFFSET, j, get_uint4(zp_u4, qp_idx));
+            }
+        }
+        // walk B in its own storage order
+        std::uint8_t* q = record + panel_weights_offset(format);
+        for (std::size_t kk = 0; kk < panel_block_size; kk++)
+        {
+            const std::size_t k = k0 + kk;
+            for (std::size_t j = 0; j < columns; j++)
+            {
+                const std::size_t b_idx = B_TRANSPOSED ? (n0 + j) * K + k : k * N + n0 + j;
+                const std::uint8_t value = format == WEIGHTS_FORMAT_INT8 ? b_data[b_idx] : get_uint4(b_data, b_idx);
+                if (dot_layout)
+                {
+                    set_dot_value(q, format, kk, j, value);
+                }
+                else if (format == WEIGHTS_FORMAT_INT8)
+                {
+                    q[kk * row_bytes + j] = value;
+                }
+                else
+                {
+                    set_panel_uint4(q + kk * row_bytes, j, value);
+                }
+            }
+        }
+    }
+}
+
+// ctx.parallel_for() on at most threads workers: past that the tasks are dealt out round robin, so the ones running at the same time stay neighbours.
+void parallel_for(const cpu::CpuContext& ctx, std::size_t threads, std::size_t tasks_count, const std::function<void(std::size_t, std::uint32_t)>& fn)
+{
+    if (tasks_count <= threads || threads >= ctx.get_threads_count())
+    {
+        ctx.parallel_for(tasks_count, fn);
+        return;
+    }
+    ctx.parallel_for(threads, [&](std::size_t worker, std::uint32_t thread_idx)
+        {
+            for (std::size_t task_idx = worker; task_idx < tasks_count; task_idx += threads)
+            {
+                fn(task_idx, thread_idx);
+            }
+        });
+}
+
+cpu::kernels::panel_kernel_fn select_panel_kernel(cpu::ISA isa, std::size_t block_size, cpu::kernels::WEIGHTS_FORMAT format, cpu::kernels::DEQUANTIZATION dequantization)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    // AVX-512 VNNI needs integer activations (see select_int8_panel_kernel()), fp16 activations run on the AVX-512 fp32 kernel.
+    if (isa >= cpu::ISA_AVX512)
+    {
+        return cpu::kernels::select_panel_kernel_avx512(block_size, format, dequantization);
+    }
+    if (isa >= cpu::ISA_AVX2)
+    {
+        return cpu::kernels::select_panel_kernel_avx2(block_size, format, dequantization);
+    }
+#endif
+    return cpu::kernels::select_panel_kernel_scalar(block_size, format, dequantization);
+}
+
+cpu::kernels::panel_kernel_fn select_int8_panel_kernel(cpu::ISA isa, std::size_t block_size, cpu::kernels::WEIGHTS_FORMAT format)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    // the AVX2 kernel has no VNNI counterpart: AVX-VNNI of the cores without AVX-512 isn't one of the cpu::ISA levels
+    if (isa >= cpu::ISA_AVX512_VNNI)
+    {
+        return cpu::kernels::select_int8_panel_kernel_avx512_vnni(block_size, format);
+    }
+    if (isa >= cpu::ISA_AVX512)
+    {
+        return cpu::kernels::select_int8_panel_kernel_avx512(block_size, format);
+    }
+    if (isa >= cpu::ISA_AVX2)
+    {
+        return cpu::kernels::select_int8_panel_kernel_avx2(block_size, format);
+    }
+#endif
+    return cpu::kernels::select_int8_panel_kernel_scalar(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn select_lut_panel_kernel(cpu::ISA isa, std::size_t block_size, cpu::kernels::WEIGHTS_FORMAT format)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    if (isa >= cpu::ISA_AVX512_VNNI)
+    {
+        return cpu::kernels::select_lut_panel_kernel_avx512_vnni(block_size, format);
+    }
+    if (isa >= cpu::ISA_AVX512)
+    {
+        return cpu::kernels::select_lut_panel_kernel_avx512(block_size, format);
+    }
+    if (isa >= cpu::ISA_AVX2)
+    {
+        return cpu::kernels::select_lut_panel_kernel_avx2(block_size, format);
+    }
+#endif
+    return cpu::kernels::select_lut_panel_kernel_scalar(block_size, format);
+}
+
+// One panel row as PANEL_WIDTH fp32: q for the integer formats, the code's value for WEIGHTS_FORMAT_LUT4.
+template<cpu::kernels::WEIGHTS_FORMAT FORMAT>
+inline void load_panel_row(const std::uint8_t* row, const float* lut, float* values)
+{
+    using namespace cpu::kernels;
+    for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+    {
+        if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+        {
+            values[j] = static_cast<float>(static_cast<std::int8_t>(row[j]));
+        }
+        else
+        {
+            const std::uint8_t byte = row[j % PANEL_ROW_BYTES];
+            const std::uint8_t code = j < PANEL_ROW_BYTES ? (byte & 0x0f) : (byte >> 4);
+            if constexpr (FORMAT == WEIGHTS_FORMAT_INT4)
+            {
+                values[j] = static_cast<float>(static_cast<std::int8_t>(code << 4) >> 4);
+            }
+            else if constexpr (FORMAT == WEIGHTS_FORMAT_LUT4)
+            {
+                values[j] = lut[code];
+            }
+            else
+            {
+                values[j] = static_cast<float>(code);
+            }
+        }
+    }
+}
+
+template<std::size_t BLOCK_SIZE, cpu::kernels::WEIGHTS_FORMAT FORMAT>
+struct per_element_panel_scalar
+{
+    static void run(const cpu::kernels::quantized_gemm_args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        using namespace cpu::kernels;
+        const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+        const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+        const std::size_t row_bytes = panel_row_bytes(FORMAT);
+        const std::uint8_t* b = args.b + panel * args.panel_stride;
+        for (std::size_t m = m0; m < m0 + m_count; m++)
+        {
+            float acc[PANEL_WIDTH]{};
+            float* c = args.c + m * args.ldc + panel * PANEL_WIDTH;
+            if (accumulate)
+            {
+                std::copy(c, c + PANEL_WIDTH, acc);
+            }
+
+            const float* a_row = args.a + m * args.K;
+            const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+            for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+            {
+                float scale[PANEL_WIDTH];
+                float bias[PANEL_WIDTH]{};
+                fp16::to_float(reinterpret_cast<const fp16::float16_t*>(record), scale, PANEL_WIDTH);
+                if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+                {
+                    load_panel_row<FORMAT>(record + PANEL_ZERO_POINT_OFFSET, args.lut, bias);
+                    for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                    {
+                        bias[j] *= -scale[j];
+                    }
+                }
+
+                const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+                for (std::size_t kk = 0; kk < block_size; kk++, q += row_bytes)
+                {
+                    const float av = a_row[k + kk];
+                    float w[PANEL_WIDTH];
+                    load_panel_row<FORMAT>(q, args.lut, w);
+                    for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                    {
+                        acc[j] += av * (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT ? w[j] * scale[j] + bias[j] : w[j] * scale[j]);
+                    }
+                }
+            }
+            if (args.epilogue && k0 + k_count == args.K)
+            {
+                store_output_row(*args.epilogue, m, panel * PANEL_WIDTH, acc);
+            }
+            else
+            {
+                std::copy(acc, acc + PANEL_WIDTH, c);
+            }
+        }
+    }
+};
+
+template<std::size_t BLOCK_SIZE, cpu::kernels::WEIGHTS_FORMAT FORMAT>
+struct folded_panel_scalar
+{
+    static void run(const cpu::kernels::quantized_gemm_args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        using namespace cpu::kernels;
+        const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+        const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+        const std::size_t row_bytes = panel_row_bytes(FORMAT);
+        const std::size_t blocks_per_row = args.K / block_size;
+        const std::uint8_t* b = args.b + panel * args.panel_stride;
+        for (std::size_t m = m0; m < m0 + m_count; m++)
+        {
+            float acc[PANEL_WIDTH]{};
+            float* c = args.c + m * args.ldc + panel * PANEL_WIDTH;
+            if (accumulate)
+            {
+                std::copy(c, c + PANEL_WIDTH, acc);
+            }
+
+            const float* a_row = args.a + m * args.K;
+            const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+            for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+            {
+                float dot[PANEL_WIDTH]{};
+                const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+                for (std::size_t kk = 0; kk < block_size; kk++, q += row_bytes)
+                {
+                    const float av = a_row[k + kk];
+                    float w[PANEL_WIDTH];
+                    load_panel_row<FORMAT>(q, args.lut, w);
+                    for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                    {
+                        dot[j] += av * w[j];
+                    }
+                }
+
+                // acc += scale * sum(a * q) - scale * zero_point * sum(a)
+                float scale[PANEL_WIDTH];
+                fp16::to_float(reinterpret_cast<const fp16::float16_t*>(record), scale, PANEL_WIDTH);
+                for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                {
+                    acc[j] += scale[j] * dot[j];
+                }
+                if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+                {
+                    float zero_point[PANEL_WIDTH];
+                    load_panel_row<FORMAT>(record + PANEL_ZERO_POINT_OFFSET, args.lut, zero_point);
+                    const float a_sum = args.a_block_sum[m * blocks_per_row + k / block_size];
+                    for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                    {
+                        acc[j] -= scale[j] * zero_point[j] * a_sum;
+                    }
+                }
+            }
+            if (args.epilogue && k0 + k_count == args.K)
+            {
+                store_output_row(*args.epilogue, m, panel * PANEL_WIDTH, acc);
+            }
+            else
+            {
+                std::copy(acc, acc + PANEL_WIDTH, c);
+            }
+        }
+    }
+};
+
+// (row r of DOT_GROUP group, column j) of the integer layout, unsigned
+template<cpu::kernels::WEIGHTS_FORMAT FORMAT>
+inline std::int32_t get_dot_value(const std::uint8_t* group, std::size_t j, std::size_t r)
+{
+    using namespace cpu::kernels;
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        return group[j * DOT_GROUP + r];
+    }
+    else
+    {
+        const std::uint8_t byte = group[(j % PANEL_ROW_BYTES) * DOT_GROUP + r];
+        return j < PANEL_ROW_BYTES ? (byte & 0x0f) : (byte >> 4);
+    }
+}
+
+template<std::size_t BLOCK_SIZE, cpu::kernels::WEIGHTS_FORMAT FORMAT>
+struct int8_panel_scalar
+{
+    static void run(const cpu::kernels::quantized_gemm_args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        using namespace cpu::kernels;
+        const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+        const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+        const std::size_t group_bytes = DOT_GROUP * panel_row_bytes(FORMAT);
+        const std::size_t blocks_per_row = args.K / block_size;
+        const std::uint8_t* b = args.b + panel * args.panel_stride;
+        for (std::size_t m = m0; m < m0 + m_count; m++)
+        {
+            float acc[PANEL_WIDTH]{};
+            float* c = args.c + m * args.ldc + panel * PANEL_WIDTH;
+            if (accumulate)
+            {
+                std::copy(c, c + PANEL_WIDTH, acc);
+            }
+
+            const std::int8_t* a_row = args.a_q + m * args.K;
+            const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+            for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+            {
+                std::int32_t dot[PANEL_WIDTH]{};
+                const std::uint8_t* group = record + panel_weights_offset(FORMAT);
+                for (std::size_t kk = 0; kk < block_size; kk += DOT_GROUP, group += group_bytes)
+                {
+                    for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                    {
+                        for (std::size_t r = 0; r < DOT_GROUP; r++)
+                        {
+                            dot[j] += a_row[k + kk + r] * get_dot_value<FORMAT>(group, j, r);
+                        }
+                    }
+                }
+
+                // acc += a_scale * scale * (sum(a_q * q) - zero_point * sum(a_q))
+                float scale[PANEL_WIDTH];
+                float zero_point[PANEL_WIDTH];
+                fp16::to_float(reinterpret_cast<const fp16::float16_t*>(record), scale, PANEL_WIDTH);
+                if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+                {
+                    load_panel_row<FORMAT>(record + PANEL_ZERO_POINT_OFFSET, args.lut, zero_point);
+                }
+                else
+                {
+                    std::fill(zero_point, zero_point + PANEL_WIDTH, static_cast<float>(dot_offset(FORMAT)));
+                }
+                const std::size_t idx = m * blocks_per_row + k / block_size;
+                for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                {
+                    const std::int32_t sum = dot[j] - static_cast<std::int32_t>(zero_point[j]) * args.a_q_block_sum[idx];
+                    acc[j] += scale[j] * args.a_scale[idx] * static_cast<float>(sum);
+                }
+            }
+            if (args.epilogue && k0 + k_count == args.K)
+            {
+                store_output_row(*args.epilogue, m, panel * PANEL_WIDTH, acc);
+            }
+            else
+            {
+                std::copy(acc, acc + PANEL_WIDTH, c);
+            }
+        }
+    }
+};
+
+// T[idx] of a LUT kernel table (see LUT_TABLE_BYTES)
+inline std::int32_t get_lut_value(const std::uint8_t* table, std::size_t idx)
+{
+    return table[idx] + static_cast<std::int8_t>(table[16 + idx]) * 256;
+}
+
+template<std::size_t BLOCK_SIZE, cpu::kernels::WEIGHTS_FORMAT FORMAT>
+struct lut_panel_scalar
+{
+    static void run(const cpu::kernels::quantized_gemm_args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        using namespace cpu::kernels;
+        const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+        const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+        const std::size_t group_bytes = DOT_GROUP * panel_row_bytes(FORMAT);
+        const std::size_t blocks_per_row = args.K / block_size;
+        const std::uint8_t* b = args.b + panel * args.panel_stride;
+        for (std::size_t m = m0; m < m0 + m_count; m++)
+        {
+            float acc[PANEL_WIDTH]{};
+            float* c = args.c + m * args.ldc + panel * PANEL_WIDTH;
+            if (accumulate)
+            {
+                std::copy(c, c + PANEL_WIDTH, acc);
+            }
+
+            const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+            for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+            {
+                std::int32_t dot[PANEL_WIDTH]{};
+                const std::uint8_t* group = record + panel_weights_offset(FORMAT);
+                const std::uint8_t* table = args.a_lut + (m * args.K + k) / DOT_GROUP * LUT_TABLE_BYTES;
+                for (std::size_t kk = 0; kk < block_size; kk += DOT_GROUP, group += group_bytes, table += LUT_TABLE_BYTES)
+                {
+                    for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                    {
+                        // sum_b 2^b * T[plane b]
+                        for (std::size_t bit = 0; bit < 4; bit++)
+                        {
+                            std::size_t idx = 0;
+                            for (std::size_t r = 0; r < DOT_GROUP; r++)
+                            {
+                                idx |= ((get_dot_value<FORMAT>(group, j, r) >> bit) & 1) << r;
+                            }
+                            dot[j] += get_lut_value(table, idx) << bit;
+                        }
+                    }
+                }
+
+                // acc += a_scale * scale * (sum(a_q * q) - zero_point * sum(a_q))
+                float scale[PANEL_WIDTH];
+                float zero_point[PANEL_WIDTH];
+                fp16::to_float(reinterpret_cast<const fp16::float16_t*>(record), scale, PANEL_WIDTH);
+                if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+                {
+                    load_panel_row<FORMAT>(record + PANEL_ZERO_POINT_OFFSET, args.lut, zero_point);
+                }
+                else
+                {
+                    std::fill(zero_point, zero_point + PANEL_WIDTH, static_cast<float>(dot_offset(FORMAT)));
+                }
+                const std::size_t idx = m * blocks_per_row + k / block_size;
+                for (std::size_t j = 0; j < PANEL_WIDTH; j++)
+                {
+                    const std::int32_t sum = dot[j] - static_cast<std::int32_t>(zero_point[j]) * args.a_q_block_sum[idx];
+                    acc[j] += scale[j] * args.a_scale[idx] * static_cast<float>(sum);
+                }
+            }
+            if (args.epilogue && k0 + k_count == args.K)
+            {
+                store_output_row(*args.epilogue, m, panel * PANEL_WIDTH, acc);
+            }
+            else
+            {
+                std::copy(acc, acc + PANEL_WIDTH, c);
+            }
+        }
+    }
+};
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_panel_kernel_scalar(std::size_t block_size, WEIGHTS_FORMAT format, DEQUANTIZATION dequantization)
+{
+    return dequantization == DEQUANTIZATION_FOLDED ? select_instantiation<folded_panel_scalar>(block_size, format) : select_instantiation<per_element_panel_scalar>(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_int8_panel_kernel_scalar(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<int8_panel_scalar>(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_lut_panel_kernel_scalar(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<lut_panel_scalar>(block_size, format);
+}
+
+const char* cpu::to_string(DEQUANTIZATION dequantization)
+{
+    switch (dequantization)
+    {
+    case DEQUANTIZATION_AUTO: return "auto";
+    case DEQUANTIZATION_PER_ELEMENT: return "per_element";
+    case DEQUANTIZATION_FOLDED: return "folded";
+    default: return "unknown";
+    }
+}
+
+bool cpu::from_string(std::string_view str, DEQUANTIZATION& dequantization)
+{
+    for (int i = 0; i < DEQUANTIZATION_COUNT; i++)
+    {
+        if (str == to_string(static_cast<DEQUANTIZATION>(i)))
+        {
+            dequantization = static_cast<DEQUANTIZATION>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* cpu::to_string(ENGINE engine)
+{
+    switch (engine)
+    {
+    case ENGINE_MULTIPLY: return "multiply";
+    case ENGINE_LUT: return "lut";
+    default: return "unknown";
+    }
+}
+
+bool cpu::from_string(std::string_view str, ENGINE& engine)
+{
+    for (int i = 0; i < ENGINE_COUNT; i++)
+    {
+        if (str == to_string(static_cast<ENGINE>(i)))
+        {
+            engine = static_cast<ENGINE>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+cpu::quantized_gemm_config_t cpu::resolve_config(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::uint32_t M, const quantized_gemm_config_t& config)
+{
+    auto ret = config;
+    const auto format = get_weights_format(weights.quantization);
+    if (weights.dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE)
+    {
+        // the integer kernels always fold
+        ret.dequantization = DEQUANTIZATION_FOLDED;
+    }
+    else if (ret.dequantization == DEQUANTIZATION_AUTO)
+    {
+        // The AVX2 folded tile is 2 rows tall to keep its accumulators in registers, so past the gemv shapes it decodes every row of B twice
+        // as often as the 4 row per element tile, which wins there. The other kernels are as tall in both modes and folding is never slower.
+        const bool avx2 = ctx.get_isa() >= ISA_AVX2 && ctx.get_isa() < ISA_AVX512;
+        ret.dequantization = avx2 && M > kernels::GEMV_MAX_M ? DEQUANTIZATION_PER_ELEMENT : DEQUANTIZATION_FOLDED;
+    }
+    if (weights.dynamic_quantization == quant::DYNAMIC_QUANTIZATION_NONE
+        || (format != kernels::WEIGHTS_FORMAT_UINT4_ZERO_POINT && format != kernels::WEIGHTS_FORMAT_INT4))
+    {
+        ret.engine = ENGINE_MULTIPLY;
+    }
+
+    const std::uint32_t threads_count = ctx.get_threads_count();
+    ret.threads = ret.threads == 0 ? threads_count : std::min(ret.threads, threads_count);
+    // Decode-style shapes (a few rows of A) are bound by streaming B: every task takes a single panel and walks its K range in registers,
+    // K is split into as many parts as it takes to keep all workers busy.
+    const bool gemv = M <= kernels::GEMV_MAX_M;
+    const std::size_t block_size = weights.panel_block_size;
+    const std::size_t blocks_count = weights.K / block_size;
+    const std::size_t panels_count = (weights.N + kernels::PANEL_WIDTH - 1) / kernels::PANEL_WIDTH;
+    ret.mc = std::clamp(ret.mc == 0 ? static_cast<std::uint32_t>(MC) : ret.mc, 1u, std::max(M, 1u));
+    ret.nc_panels = static_cast<std::uint32_t>(std::clamp<std::size_t>(ret.nc_panels == 0 ? (gemv ? 1 : NC_PANELS) : ret.nc_panels, 1, panels_count));
+    std::size_t kc = ret.kc == 0 ? KC : ret.kc;
+    if (ret.kc == 0 && gemv)
+    {
+        const std::size_t k_parts = panels_count < ret.threads ? (ret.threads + panels_count - 1) / panels_count : 1;
+        kc = (blocks_count + k_parts - 1) / k_parts * block_size;
+    }
+    // KC has to cover whole panel records.
+    ret.kc = static_cast<std::uint32_t>(std::clamp(kc / block_size, std::size_t(1), blocks_count) * block_size);
+    return ret;
+}
+
+std::uint32_t cpu::get_panel_block_size(const quantized_gemm_desc_t& desc)
+{
+    if (!quant::is_per_channel(desc.quantization))
+    {
+        return desc.block_size;
+    }
+    // long enough to amortize the scale loads, short enough to keep the KC tiling of the kernels
+    for (const std::uint32_t block_size : { 64u, 32u, 16u })
+    {
+        if (desc.K % block_size == 0)
+        {
+            return block_size;
+        }
+    }
+    return desc.K;
+}
+
+std::size_t cpu::get_panel_stride(const quantized_gemm_desc_t& desc)
+{
+    return kernels::panel_bytes(desc.K, get_panel_block_size(desc), get_weights_format(desc.quantization));
+}
+
+cpu::quantized_gemm_weights_t cpu::prepare_quantized_gemm_weights(const CpuContext& ctx, const quantized_gemm_desc_t& desc,
+    std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point)
+{
+    using namespace kernels;
+    const std::size_t K = desc.K;
+    const std::size_t N = desc.N;
+    const std::size_t block_size = quant::get_block_size(desc.quantization, desc.K, desc.block_size);
+    [[maybe_unused]] const std::size_t blocks_count = K / block_size;
+    assert(block_size != 0 && K % block_size == 0);
+    assert(b.size() >= tensor::get_size_in_bytes(quant::get_weights_data_type(desc.quantization), N * K));
+    assert(b_scale.size() >= N * blocks_count * sizeof(std::uint16_t));
+    assert(!quant::has_zero_point(desc.quantization) || b_zero_point.size() >= (N * blocks_count + 1) / 2);
+    assert(desc.dynamic_quantization == quant::DYNAMIC_QUANTIZATION_NONE || quant::supports_dynamic_quantization(desc.quantization, desc.K, desc.block_size));
+
+    const auto format = get_weights_format(desc.quantization);
+    const std::size_t panels_count = (N + PANEL_WIDTH - 1) / PANEL_WIDTH;
+    quantized_gemm_weights_t weights{};
+    weights.K = desc.K;
+    weights.N = desc.N;
+    weights.block_size = static_cast<std::uint32_t>(block_size);
+    weights.b_transposed = desc.b_transposed;
+    weights.quantization = desc.quantization;
+    weights.dynamic_quantization = desc.dynamic_quantization;
+    weights.panel_block_size = get_panel_block_size(desc);
+    weights.panel_stride = get_panel_stride(desc);
+    weights.packed_size = panels_count * weights.panel_stride;
+    weights.storage = std::make_unique_for_overwrite<std::byte[]>(weights.packed_size);
+    weights.packed = { weights.storage.get(), weights.packed_size };
+
+    const auto* b_data = reinterpret_cast<const std::uint8_t*>(b.data());
+    const auto* scale_f16 = reinterpret_cast<const std::uint16_t*>(b_scale.data());
+    const auto* zp_u4 = reinterpret_cast<const std::uint8_t*>(b_zero_point.data());
+    ctx.parallel_for(panels_count, [&](std::size_t panel, std::uint32_t)
+        {
+            auto* record = reinterpret_cast<std::uint8_t*>(weights.storage.get()) + panel * weights.panel_stride;
+            std::memset(record, 0, weights.panel_stride);
+            if (desc.b_transposed)
+            {
+                pack_panel<true>(weights, format, b_data, scale_f16, zp_u4, panel, record);
+            }
+            else
+            {
+                pack_panel<false>(weights, format, b_data, scale_f16, zp_u4, panel, record);
+            }
+        });
+    return weights;
+}
+
+void cpu::quantized_gemm(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::uint32_t M,
+    std::span<const std::byte> a, std::span<std::byte> out, const quantized_gemm_epilogue_t& epilogue, std::span<const std::byte> residual,
+    const quantized_gemm_config_t& config)
+{
+    const quantized_gemm_batch_item_t item{ M, a, out, residual };
+    quantized_gemm(ctx, weights, std::span<const quantized_gemm_batch_item_t>(&item, 1), epilogue, config);
+}
+
+void cpu::quantized_gemm(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::span<const quantized_gemm_batch_item_t> batch,
+    const quantized_gemm_epilogue_t& epilogue, const quantized_gemm_config_t& config)
+{
+    const std::size_t K = weights.K;
+    const std::size_t N = weights.N;
+    const std::size_t block_size = weights.panel_block_size;
+    const auto format = get_weights_format(weights.quantization);
+
+    std::size_t M = 0;
+    for (const auto& item : batch)
+    {
+        M += item.M;
+    }
+    if (M == 0)
+    {
+        return;
+    }
+
+    // all scratch memory comes from the context's arena and is released on return
+    auto& arena = ctx.get_arena();
+    const ArenaScope arena_scope(arena);
+
+    // rows of all requests stacked: row m reads a_rows[m] (and residual_rows[m]) and writes out_rows[m]
+    const std::size_t out_row_bytes = tensor::get_size_in_bytes(epilogue::get_output_data_type(epilogue.desc), N);
+    const auto a_rows = arena.allocate<const fp16::float16_t*>(M);
+    const auto out_rows = arena.allocate<void*>(M);
+    const auto residual_rows = arena.allocate<const std::uint16_t*>(epilogue.desc.residual ? M : 0);
+    std::size_t row = 0;
+    for (const auto& item : batch)
+    {
+        assert(item.a.size() >= item.M * K * sizeof(std::uint16_t));
+        assert(item.out.size() >= item.M * out_row_bytes);
+        assert(!epilogue.desc.residual || item.residual.size() >= item.M * N * sizeof(std::uint16_t));
+        const auto* a_f16 = fp16::as_float16(item.a).data();
+        for (std::size_t m = 0; m < item.M; m++, row++)
+        {
+            a_rows[row] = a_f16 + m * K;
+            out_rows[row] = item.out.data() + m * out_row_bytes;
+            if (epilogue.desc.residual)
+            {
+                residual_rows[row] = reinterpret_cast<const std::uint16_t*>(item.residual.data()) + m * N;
+            }
+        }
+    }
+
+    // A is converted once and then reused by every tile, the block sums only feed the zero point correction of the folded kernels.
+    // With dynamic quantization A is converted further to int8 codes, their scale and sum per panel record feed the integer kernels
+    // and the LUT engine builds its tables of every DOT_GROUP of codes.
+    const std::size_t blocks_count = K / block_size;
+    const bool int8_activations = weights.dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE;
+    const auto resolved = resolve_config(ctx, weights, static_cast<std::uint32_t>(M), config);
+    const bool folded = resolved.dequantization == DEQUANTIZATION_FOLDED;
+    const bool lut = resolved.engine == ENGINE_LUT;
+    const bool block_sums = !int8_activations && folded && format == kernels::WEIGHTS_FORMAT_UINT4_ZERO_POINT;
+    const auto a_f32 = arena.allocate<float>(M * K);
+    const auto a_block_sum = arena.allocate<float>(block_sums ? M * blocks_count : 0);
+    const auto a_q = arena.allocate<std::int8_t>(int8_activations ? M * K : 0);
+    const auto a_scale = arena.allocate<float>(int8_activations ? M * blocks_count : 0);
+    const auto a_q_block_sum = arena.allocate<std::int32_t>(int8_activations ? M * blocks_count : 0);
+    const auto a_lut = arena.allocate<std::uint8_t>(lut ? M * K / kernels::DOT_GROUP * kernels::LUT_TABLE_BYTES : 0);
+    // A scale per row, or per quantization block of B (a whole number of panel records)
+    const std::size_t a_group = weights.dynamic_quantization == quant::DYNAMIC_QUANTIZATION_INT8_PER_BLOCK ? weights.block_size : K;
+    parallel_for(ctx, resolved.threads, M, [&](std::size_t m, std::uint32_t)
+        {
+            fp16::to_float(a_rows[m], a_f32.data() + m * K, K);
+            for (std::size_t k0 = 0; int8_activations && k0 < K; k0 += a_group)
+            {
+                const float scale = quant::quantize_int8(a_f32.data() + m * K + k0, a_group, a_q.data() + m * K + k0);
+                for (std::size_t blk = k0 / block_size; blk < (k0 + a_group) / block_size; blk++)
+                {
+                    std::int32_t sum = 0;
+                    for (std::size_t k = blk * block_size; k < (blk + 1) * block_size; k++)
+                    {
+                        sum += a_q[m * K + k];
+                    }
+                    a_scale[m * blocks_count + blk] = scale;
+                    a_q_block_sum[m * blocks_count + blk] = sum;
+                }
+            }
+            // T[p] = sum of the a_q of the group selected by the bits of p, as low and high bytes
+            for (std::size_t group = 0; lut && group < K / kernels::DOT_GROUP; group++)
+            {
+                const std::int8_t* a_group_q = a_q.data() + m * K + group * kernels::DOT_GROUP;
+                std::uint8_t* table = a_lut.data() + (m * K / kernels::DOT_GROUP + group) * kernels::LUT_TABLE_BYTES;
+                for (std::size_t p = 0; p < 16; p++)
+                {
+                    std::int32_t sum = 0;
+                    for (std::size_t r = 0; r < kernels::DOT_GROUP; r++)
+                    {
+                        sum += (p >> r) & 1 ? a_group_q[r] : 0;
+                    }
+                    table[p] = static_cast<std::uint8_t>(sum & 0xff);
+                    table[16 + p] = static_cast<std::uint8_t>(sum >> 8);
+                }
+            }
+            for (std::size_t blk = 0; block_sums && blk < blocks_count; blk++)
+            {
+                float sum = 0.0f;
+                for (std::size_t k = blk * block_size; k < (blk + 1) * block_size; k++)
+                {
+                    sum += a_f32[m * K + k];
+                }
+                a_block_sum[m * blocks_count + blk] = sum;
+            }
+        });
+
+    const std::size_t panels_count = (N + kernels::PANEL_WIDTH - 1) / kernels::PANEL_WIDTH;
+    kernels::quantized_gemm_args_t args{};
+    args.a = a_f32.data();
+    args.a_block_sum = a_block_sum.data();
+    args.a_q = a_q.data();
+    args.a_scale = a_scale.data();
+    args.a_q_block_sum = a_q_block_sum.data();
+    args.a_lut = a_lut.data();
+    args.b = reinterpret_cast<const std::uint8_t*>(weights.packed.data());
+    args.lut = quant::get_lookup_table(weights.quantization);
+    args.K = K;
+    args.ldc = panels_count * kernels::PANEL_WIDTH;
+    args.block_size = block_size;
+    args.panel_stride = weights.panel_stride;
+
+    const auto bias_f32 = arena.allocate<float>(epilogue.desc.bias ? args.ldc : 0);
+    if (epilogue.desc.bias)
+    {
+        assert(epilogue.bias.size() >= N * sizeof(std::uint16_t));
+        fp16::to_float(fp16::as_float16(epilogue.bias).data(), bias_f32.data(), N);
+        std::fill(bias_f32.begin() + N, bias_f32.end(), 0.0f);
+    }
+    kernels::epilogue_args_t epilogue_args{};
+    epilogue_args.bias = epilogue.desc.bias ? bias_f32.data() : nullptr;
+    epilogue_args.residual_rows = epilogue.desc.residual ? residual_rows.data() : nullptr;
+    epilogue_args.out_rows = out_rows.data();
+    epilogue_args.N = N;
+    epilogue_args.activation = get_activation(epilogue.desc.activation);
+    epilogue_args.requantize = epilogue.desc.requantize;
+    epilogue_args.output_scale_inv = 1.0f / epilogue.desc.output_scale;
+
+    auto panel_kernel = select_panel_kernel(ctx.get_isa(), block_size, format, folded ? kernels::DEQUANTIZATION_FOLDED : kernels::DEQUANTIZATION_PER_ELEMENT);
+    if (int8_activations)
+    {
+        panel_kernel = lut ? select_lut_panel_kernel(ctx.get_isa(), block_size, format) : select_int8_panel_kernel(ctx.get_isa(), block_size, format);
+    }
+    const std::size_t threads = resolved.threads;
+    const std::size_t mc = resolved.mc;
+    const std::size_t nc_panels = resolved.nc_panels;
+    const std::size_t kc = resolved.kc;
+    const std::size_t k_chunks = (K + kc - 1) / kc;
+    const std::size_t m_tiles = (M + mc - 1) / mc;
+    const std::size_t n_tiles = (panels_count + nc_panels - 1) / nc_panels;
+    const std::size_t tiles = m_tiles * n_tiles;
+
+    // Skinny shapes have fewer tiles than threads: split K as well and reduce the partial results.
+    std::size_t k_splits = 1;
+    if (tiles < threads)
+    {
+        k_splits = std::min(k_chunks, (threads + tiles - 1) / tiles);
+    }
+    const std::size_t k_chunks_per_split = (k_chunks + k_splits - 1) / k_splits;
+    k_splits = (k_chunks + k_chunks_per_split - 1) / k_chunks_per_split;
+
+    // Without a K split the tile completing K applies the epilogue and stores OUT from registers, c only holds the partials of earlier K chunks.
+    // Split partials are reduced first, the reduction applies the epilogue then.
+    const std::size_t c_size = M * args.ldc;
+    const auto c_f32 = arena.allocate<float>(k_splits * c_size);
+    args.epilogue = k_splits == 1 ? &epilogue_args : nullptr;
+
+    // Tiles are ordered M-fastest, so tiles running at the same time share the same panels of B.
+    parallel_for(ctx, threads, k_splits * tiles, [&](std::size_t task_idx, std::uint32_t)
+        {
+            const std::size_t tile_idx = task_idx % tiles;
+            const std::size_t split = task_idx / tiles;
+            const std::size_t m0 = (tile_idx % m_tiles) * mc;
+            const std::size_t mb = std::min(mc, M - m0);
+            const std::size_t p0 = (tile_idx / m_tiles) * nc_panels;
+            const std::size_t p_end = std::min(p0 + nc_panels, panels_count);
+            const std::size_t k_begin = split * k_chunks_per_split * kc;
+            const std::size_t k_end = std::min(K, k_begin + k_chunks_per_split * kc);
+
+            auto split_args = args;
+            split_args.c = c_f32.data() + split * c_size;
+            for (std::size_t k0 = k_begin; k0 < k_end; k0 += kc)
+            {
+                const std::size_t kb = std::min(kc, k_end - k0);
+                for (std::size_t panel = p0; panel < p_end; panel++)
+                {
+                    panel_kernel(split_args, m0, mb, panel, k0, kb, k0 != k_begin);
+                }
+            }
+        });
+
+    if (k_splits == 1)
+    {
+        return;
+    }
+    parallel_for(ctx, threads, M, [&](std::size_t m, std::uint32_t)
+        {
+            float* c_row = c_f32.data() + m * args.ldc;
+            for (std::size_t split = 1; split < k_splits; split++)
+            {
+                const float* partial_row = c_row + split * c_size;
+                for (std::size_t n = 0; n < N; n++)
+                {
+                    c_row[n] += partial_row[n];
+                }
+            }
+            for (std::size_t n0 = 0; n0 < N; n0 += kernels::PANEL_WIDTH)
+            {
+                store_output_row(epilogue_args, m, n0, c_row + n0);
+            }
+        });
+}
+
+void cpu::quantized_gemm(const CpuContext& ctx, const quantized_gemm_desc_t& desc,
+    std::span<const std::byte> a, std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point,
+    std::span<std::byte> out)
+{
+    const auto weights = prepare_quantized_gemm_weights(ctx, desc, b, b_scale, b_zero_point);
+    quantized_gemm(ctx, weights, desc.M, a, out);
+}
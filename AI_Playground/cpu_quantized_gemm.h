@@ -0,0 +1,143 @@
+#pragma once
+#include "epilogue.h"
+#include "quantization.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace cpu
+{
+class CpuContext;
+
+struct quantized_gemm_desc_t
+{
+    std::uint32_t M = 0;
+    std::uint32_t K = 0;
+    std::uint32_t N = 0;
+    std::uint32_t block_size = 0;   // ignored by per channel schemes
+    bool b_transposed = true;   // B is [N, K], otherwise [K, N]
+    quant::SCHEME quantization = quant::SCHEME_UINT4_ASYMMETRIC;
+    // A quantized to int8 per call and multiplied on integer dot products, see quant::supports_dynamic_quantization() for the schemes
+    quant::DYNAMIC_QUANTIZATION dynamic_quantization = quant::DYNAMIC_QUANTIZATION_NONE;
+};
+
+// Rows of B per panel record (see cpu_quantized_gemm_kernels.h): the quantization block size,
+// per channel schemes split K into blocks repeating the channel's scale, so K is still walked in whole records.
+std::uint32_t get_panel_block_size(const quantized_gemm_desc_t& desc);
+// Bytes between consecutive packed panels.
+std::size_t get_panel_stride(const quantized_gemm_desc_t& desc);
+
+// B repacked into the kernels' panel layout (see cpu_quantized_gemm_kernels.h),
+// built once by prepare_quantized_gemm_weights() and reused by every call.
+struct quantized_gemm_weights_t
+{
+    std::uint32_t K = 0;
+    std::uint32_t N = 0;
+    std::uint32_t block_size = 0;       // of the quantization, K for per channel schemes
+    bool b_transposed = true;           // layout of the source B, the panels are the same for both
+    quant::SCHEME quantization = quant::SCHEME_UINT4_ASYMMETRIC;
+    quant::DYNAMIC_QUANTIZATION dynamic_quantization = quant::DYNAMIC_QUANTIZATION_NONE;   // the integer kernels have their own q row layout
+    std::uint32_t panel_block_size = 0;
+
+    std::size_t panel_stride = 0;   // bytes between consecutive panels
+    std::size_t packed_size = 0;
+    // left uninitialized by the allocation, so every panel is first touched by the worker packing it (NUMA first-touch placement),
+    // empty when the panels are mapped from a prepacked weights file (see cpu_packed_weights_file.h)
+    std::unique_ptr<std::byte[]> storage;
+    std::span<const std::byte> packed;  // the panels, packed_size bytes
+};
+
+// OUT[M, N] (fp16) = A[M, K] (fp16) x dequantize(B[N, K]) (B is transposed).
+// Dequantization is blockwise along K, for the default scheme: scale[N, K / block_size] (fp16) * (B (uint4) - zero_point[N, K / block_size] (uint4)).
+// The other schemes (see quantization.h) have no zero point (b_zero_point is ignored), per channel ones have scale[N, 1].
+// With desc.b_transposed == false B is [K, N] and the quantization params [K / block_size, N].
+// 4 bit tensors are packed two elements per byte, low nibble first.
+quantized_gemm_weights_t prepare_quantized_gemm_weights(const CpuContext& ctx, const quantized_gemm_desc_t& desc,
+    std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point);
+
+// Post-ops applied to the output tiles while they are still in registers (see epilogue.h), OUT is int8 when they requantize.
+struct quantized_gemm_epilogue_t
+{
+    epilogue::desc_t desc{};
+    std::span<const std::byte> bias;    // [N] fp16, read when desc.bias
+};
+
+// Where the fp16 activation kernels apply the quantization params of B:
+// per element dequantizes every weight in the inner loop, folded multiplies A by the raw q and corrects a whole block at once:
+//   sum(a * scale * (q - zero_point)) = scale * sum(a * q) - scale * zero_point * sum(a)
+// The block sums of A are computed once per call, so the zero point costs one fma per block instead of one per element.
+// The integer kernels (dynamic quantization) always fold.
+enum DEQUANTIZATION
+{
+    DEQUANTIZATION_AUTO,            // picked per ISA and M
+    DEQUANTIZATION_PER_ELEMENT,
+    DEQUANTIZATION_FOLDED,
+    // ..
+    DEQUANTIZATION_COUNT
+};
+
+const char* to_string(DEQUANTIZATION dequantization);
+// "auto", "per_element" or "folded"
+bool from_string(std::string_view str, DEQUANTIZATION& dequantization);
+
+// How the products of A and B are evaluated:
+// multiply runs the fp32 kernels, or the integer dot product kernels with dynamic quantization of A.
+// lut (T-MAC) replaces the multiplies by lookups into tables of partial sums of A for every pattern of weight bits (see cpu_quantized_gemm_kernels.h),
+// it needs dynamic quantization of A and a 4 bit integer scheme (uint4, int4), calls on other weights run multiply. The results are the same.
+// The lookups beat dequantizing the weights but not the integer dot products, so lut only runs on request.
+enum ENGINE
+{
+    ENGINE_MULTIPLY,
+    ENGINE_LUT,
+    // ..
+    ENGINE_COUNT
+};
+
+const char* to_string(ENGINE engine);
+// "multiply" or "lut"
+bool from_string(std::string_view str, ENGINE& engine);
+
+// Execution choices of a call, they don't change the prepacked weights.
+// The blocking and thread count default to 0, picked per shape; cpu_quantized_gemm_tuner.h measures them instead.
+struct quantized_gemm_config_t
+{
+    DEQUANTIZATION dequantization = DEQUANTIZATION_AUTO;
+    ENGINE engine = ENGINE_MULTIPLY;
+    std::uint32_t mc = 0;           // rows of A per output tile
+    std::uint32_t nc_panels = 0;    // panels of B per output tile
+    std::uint32_t kc = 0;           // K per kernel call, rounded down to whole panel records
+    std::uint32_t threads = 0;      // workers of the call, at most the context's threads
+
+    bool operator==(const quantized_gemm_config_t&) const = default;
+};
+
+// What a call with M rows runs: the automatic choices resolved, the ones the weights don't support replaced, every blocking factor set.
+quantized_gemm_config_t resolve_config(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::uint32_t M, const quantized_gemm_config_t& config);
+
+// residual: [M, N] fp16, read when epilogue.desc.residual
+void quantized_gemm(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::uint32_t M,
+    std::span<const std::byte> a, std::span<std::byte> out, const quantized_gemm_epilogue_t& epilogue = {}, std::span<const std::byte> residual = {},
+    const quantized_gemm_config_t& config = {});
+
+// One request of a batched call: a[M, K] (fp16) -> out[M, N] (fp16, or int8 when the epilogue requantizes).
+struct quantized_gemm_batch_item_t
+{
+    std::uint32_t M = 0;
+    std::span<const std::byte> a;
+    std::span<std::byte> out;
+    std::span<const std::byte> residual;    // [M, N] fp16, read when the epilogue has a residual
+};
+
+// Independent requests sharing the same B (and epilogue). Their rows are stacked into one GEMM,
+// so every panel of B is streamed and dequantized once per call instead of once per request.
+void quantized_gemm(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::span<const quantized_gemm_batch_item_t> batch,
+    const quantized_gemm_epilogue_t& epilogue = {}, const quantized_gemm_config_t& config = {});
+
+// One-shot variant, prepares the weights on every call.
+void quantized_gemm(const CpuContext& ctx, const quantized_gemm_desc_t& desc,
+    std::span<const std::byte> a, std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point,
+    std::span<std::byte> out);
+}
@@ -0,0 +1,696 @@
+#include "cpu_quantized_gemm_kernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+
+namespace
+{
+using namespace cpu::kernels;
+using args_t = quantized_gemm_args_t;
+
+// 16 ymm registers: a panel is 2 ymm wide, 8 accumulators, 2 weights, 4 quantization params and A.
+constexpr std::size_t MR = 4;
+
+// 16 codes in two ymm halves, permutevar8x32 reads the low 3 bits of a code and bit 3 picks the half
+inline __m256 lookup(__m256i codes, const __m256 lut[2])
+{
+    const __m256 lo = _mm256_permutevar8x32_ps(lut[0], codes);
+    const __m256 hi = _mm256_permutevar8x32_ps(lut[1], codes);
+    return _mm256_blendv_ps(lo, hi, _mm256_castsi256_ps(_mm256_slli_epi32(codes, 28)));
+}
+
+// 8 bytes, one per column -> fp32
+template<WEIGHTS_FORMAT FORMAT>
+inline __m256 to_weights(__m128i bytes, const __m256 lut[2])
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT4 || FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+    }
+    else if constexpr (FORMAT == WEIGHTS_FORMAT_LUT4)
+    {
+        return lookup(_mm256_cvtepu8_epi32(bytes), lut);
+    }
+    else
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+    }
+}
+
+// One panel row -> columns 0-7 and 8-15 as fp32: q for the integer formats, the code's value for WEIGHTS_FORMAT_LUT4.
+// The 4 bit formats hold columns 0-7 in the low nibbles and 8-15 in the high nibbles. int4 nibbles are moved to the high half of their byte,
+// so they keep their sign as int8: the value is 16 x q, load_scale() compensates.
+template<WEIGHTS_FORMAT FORMAT>
+inline void load_panel_row(const std::uint8_t* src, const __m256 lut[2], __m256& lo_cols, __m256& hi_cols)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        lo_cols = to_weights<FORMAT>(bytes, lut);
+        hi_cols = to_weights<FORMAT>(_mm_srli_si128(bytes, 8), lut);
+    }
+    else if constexpr (FORMAT == WEIGHTS_FORMAT_INT4)
+    {
+        const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+        const __m128i mask = _mm_set1_epi8(static_cast<char>(0xf0));
+        lo_cols = to_weights<FORMAT>(_mm_and_si128(_mm_slli_epi16(packed, 4), mask), lut);
+        hi_cols = to_weights<FORMAT>(_mm_and_si128(packed, mask), lut);
+    }
+    else
+    {
+        const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        lo_cols = to_weights<FORMAT>(_mm_and_si128(packed, mask), lut);
+        hi_cols = to_weights<FORMAT>(_mm_and_si128(_mm_srli_epi16(packed, 4), mask), lut);
+    }
+}
+
+template<WEIGHTS_FORMAT FORMAT>
+inline void load_lut(const args_t& args, __m256 lut[2])
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_LUT4)
+    {
+        lut[0] = _mm256_loadu_ps(args.lut);
+        lut[1] = _mm256_loadu_ps(args.lut + 8);
+    }
+    else
+    {
+        lut[0] = _mm256_setzero_ps();
+        lut[1] = _mm256_setzero_ps();
+    }
+}
+
+template<WEIGHTS_FORMAT FORMAT>
+inline void load_scale(const std::uint8_t* record, __m256 scale[2])
+{
+    scale[0] = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(record)));
+    scale[1] = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(record + 16)));
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT4)
+    {
+        scale[0] = _mm256_mul_ps(scale[0], _mm256_set1_ps(1.0f / 16.0f));
+        scale[1] = _mm256_mul_ps(scale[1], _mm256_set1_ps(1.0f / 16.0f));
+    }
+}
+
+// -zero_point * scale of the record, zero point formats only
+inline void load_bias(const std::uint8_t* record, const __m256 scale[2], __m256 bias[2])
+{
+    const __m256 no_lut[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+    load_panel_row<WEIGHTS_FORMAT_UINT4_ZERO_POINT>(record + PANEL_ZERO_POINT_OFFSET, no_lut, bias[0], bias[1]);
+    for (std::size_t j = 0; j < 2; j++)
+    {
+        bias[j] = _mm256_fnmadd_ps(bias[j], scale[j], _mm256_setzero_ps());
+    }
+}
+
+// e^x, Cephes polynomial on x - n * ln(2) scaled by 2^n through the exponent bits, relative error ~1e-7 over the clamped range
+inline __m256 exp_ps(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.3f));
+    const __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+    __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+    const __m256i pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(pow2n));
+}
+
+// x * sigmoid(z) = x / (1 + e^-z)
+inline __m256 mul_sigmoid(__m256 x, __m256 z)
+{
+    return _mm256_div_ps(x, _mm256_add_ps(_mm256_set1_ps(1.0f), exp_ps(_mm256_sub_ps(_mm256_setzero_ps(), z))));
+}
+
+inline __m256 activate(__m256 x, ACTIVATION activation)
+{
+    switch (activation)
+    {
+    case ACTIVATION_GELU:
+    {
+        const __m256 x3 = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+        return mul_sigmoid(x, _mm256_mul_ps(_mm256_set1_ps(1.5957691216f), _mm256_fmadd_ps(_mm256_set1_ps(0.044715f), x3, x)));
+    }
+    case ACTIVATION_SILU: return mul_sigmoid(x, x);
+    default: return x;
+    }
+}
+
+// Finished row m of a tile: post-ops on the accumulator and a store of the N - n0 valid columns of OUT,
+// the last panel of a row goes through a staging buffer instead of masked loads and stores.
+inline void store_output_row(const epilogue_args_t& epilogue, std::size_t m, std::size_t n0, const __m256 acc[2])
+{
+    const std::size_t columns = epilogue.N - n0 < PANEL_WIDTH ? epilogue.N - n0 : PANEL_WIDTH;
+    __m256 x[2] = { acc[0], acc[1] };
+    for (std::size_t j = 0; j < 2; j++)
+    {
+        if (epilogue.bias)
+        {
+            x[j] = _mm256_add_ps(x[j], _mm256_loadu_ps(epilogue.bias + n0 + j * 8));
+        }
+        x[j] = activate(x[j], epilogue.activation);
+    }
+    if (epilogue.residual_rows)
+    {
+        const std::uint16_t* residual = epilogue.residual_rows[m] + n0;
+        alignas(32) std::uint16_t staging[PANEL_WIDTH]{};
+        if (columns < PANEL_WIDTH)
+        {
+            for (std::size_t j = 0; j < columns; j++)
+            {
+                staging[j] = residual[j];
+            }
+            residual = staging;
+        }
+        for (std::size_t j = 0; j < 2; j++)
+        {
+            x[j] = _mm256_add_ps(x[j], _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(residual + j * 8))));
+        }
+    }
+
+    alignas(32) std::uint8_t staging[PANEL_WIDTH * sizeof(std::uint16_t)];
+    std::size_t row_bytes = 0;
+    std::uint8_t* dst = nullptr;
+    if (epilogue.requantize)
+    {
+        const __m256 output_scale_inv = _mm256_set1_ps(epilogue.output_scale_inv);
+        const __m256i q32_lo = _mm256_cvtps_epi32(_mm256_mul_ps(x[0], output_scale_inv));
+        const __m256i q32_hi = _mm256_cvtps_epi32(_mm256_mul_ps(x[1], output_scale_inv));
+        // packs works per 128 bit lane, the permute restores the column order
+        const __m256i q16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(q32_lo, q32_hi), 0xd8);
+        const __m128i q8 = _mm_packs_epi16(_mm256_castsi256_si128(q16), _mm256_extracti128_si256(q16, 1));
+        dst = static_cast<std::uint8_t*>(epilogue.out_rows[m]) + n0;
+        row_bytes = columns;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(columns < PANEL_WIDTH ? staging : dst), q8);
+    }
+    else
+    {
+        dst = static_cast<std::uint8_t*>(epilogue.out_rows[m]) + n0 * sizeof(std::uint16_t);
+        row_bytes = columns * sizeof(std::uint16_t);
+        std::uint8_t* out = columns < PANEL_WIDTH ? staging : dst;
+        for (std::size_t j = 0; j < 2; j++)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j * 16), _mm256_cvtps_ph(x[j], _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        }
+    }
+    if (columns < PANEL_WIDTH)
+    {
+        for (std::size_t j = 0; j < row_bytes; j++)
+        {
+            dst[j] = staging[j];
+        }
+    }
+}
+
+// c rows of the tile, or OUT rows when this call completes K
+template<std::size_t mr>
+inline void store_tile(const args_t& args, std::size_t m0, std::size_t panel, float* c, std::size_t k_end, const __m256 (&acc)[mr][2])
+{
+    if (args.epilogue && k_end == args.K)
+    {
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            store_output_row(*args.epilogue, m0 + i, panel * PANEL_WIDTH, acc[i]);
+        }
+        return;
+    }
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        for (std::size_t j = 0; j < 2; j++)
+        {
+            _mm256_storeu_ps(c + (m0 + i) * args.ldc + j * 8, acc[i][j]);
+        }
+    }
+}
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+void micro_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t row_bytes = panel_row_bytes(FORMAT);
+    __m256 acc[mr][2];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        for (std::size_t j = 0; j < 2; j++)
+        {
+            acc[i][j] = accumulate ? _mm256_loadu_ps(c + (m0 + i) * args.ldc + j * 8) : _mm256_setzero_ps();
+        }
+    }
+
+    __m256 lut[2];
+    load_lut<FORMAT>(args, lut);
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        // w = q * scale + bias with a zero point, so dequantization is a single fma, q * scale without
+        __m256 scale[2];
+        __m256 bias[2];
+        load_scale<FORMAT>(record, scale);
+        if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+        {
+            load_bias(record, scale, bias);
+        }
+
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        const float* a = args.a + m0 * args.K + k;
+        for (std::size_t kk = 0; kk < block_size; kk++)
+        {
+            __m256 w[2];
+            load_panel_row<FORMAT>(q + kk * row_bytes, lut, w[0], w[1]);
+            for (std::size_t j = 0; j < 2; j++)
+            {
+                w[j] = FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT ? _mm256_fmadd_ps(w[j], scale[j], bias[j]) : _mm256_mul_ps(w[j], scale[j]);
+            }
+            for (std::size_t i = 0; i < mr; i++)
+            {
+                const __m256 av = _mm256_broadcast_ss(a + i * args.K + kk);
+                for (std::size_t j = 0; j < 2; j++)
+                {
+                    acc[i][j] = _mm256_fmadd_ps(av, w[j], acc[i][j]);
+                }
+            }
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, acc);
+}
+
+// Bytes ahead of the current row the folded and integer kernels prefetch: with a few rows of A, B is streamed once and the prefetch hides DRAM latency.
+constexpr std::size_t PREFETCH_DISTANCE = 1024;
+// 2 rows x 2 halves x 2 independent accumulators + 2 x 2 outputs + weights fit the 16 ymm registers, taller tiles would spill
+constexpr std::size_t FOLDED_MR = 2;
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+void folded_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t row_bytes = panel_row_bytes(FORMAT);
+    // with few rows the fma chains are latency bound, independent accumulators over k keep the fma ports busy
+    constexpr std::size_t KU = mr == 1 ? 4 : 2;
+    const std::size_t blocks_per_row = args.K / block_size;
+
+    __m256 out[mr][2];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        for (std::size_t j = 0; j < 2; j++)
+        {
+            out[i][j] = accumulate ? _mm256_loadu_ps(c + (m0 + i) * args.ldc + j * 8) : _mm256_setzero_ps();
+        }
+    }
+
+    __m256 lut[2];
+    load_lut<FORMAT>(args, lut);
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        __m256 acc[mr][KU][2];
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            for (std::size_t u = 0; u < KU; u++)
+            {
+                acc[i][u][0] = _mm256_setzero_ps();
+                acc[i][u][1] = _mm256_setzero_ps();
+            }
+        }
+
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        const float* a = args.a + m0 * args.K + k;
+        std::size_t kk = 0;
+        for (; kk + KU <= block_size; kk += KU)
+        {
+            _mm_prefetch(reinterpret_cast<const char*>(q + kk * row_bytes + PREFETCH_DISTANCE), _MM_HINT_T0);
+            for (std::size_t u = 0; u < KU; u++)
+            {
+                __m256 w[2];
+                load_panel_row<FORMAT>(q + (kk + u) * row_bytes, lut, w[0], w[1]);
+                for (std::size_t i = 0; i < mr; i++)
+                {
+                    const __m256 av = _mm256_broadcast_ss(a + i * args.K + kk + u);
+                    acc[i][u][0] = _mm256_fmadd_ps(av, w[0], acc[i][u][0]);
+                    acc[i][u][1] = _mm256_fmadd_ps(av, w[1], acc[i][u][1]);
+                }
+            }
+        }
+        // the specialized block sizes are multiples of the unroll, only the generic kernel has a tail
+        if constexpr (BLOCK_SIZE == 0 || BLOCK_SIZE % KU != 0)
+        {
+            for (; kk < block_size; kk++)
+            {
+                __m256 w[2];
+                load_panel_row<FORMAT>(q + kk * row_bytes, lut, w[0], w[1]);
+                for (std::size_t i = 0; i < mr; i++)
+                {
+                    const __m256 av = _mm256_broadcast_ss(a + i * args.K + kk);
+                    acc[i][0][0] = _mm256_fmadd_ps(av, w[0], acc[i][0][0]);
+                    acc[i][0][1] = _mm256_fmadd_ps(av, w[1], acc[i][0][1]);
+                }
+            }
+        }
+
+        // out += scale * sum(a * q) (+ bias * sum(a), bias = -zero_point * scale)
+        __m256 scale[2];
+        __m256 bias[2];
+        load_scale<FORMAT>(record, scale);
+        if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+        {
+            load_bias(record, scale, bias);
+        }
+        const std::size_t blk = k / block_size;
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            for (std::size_t j = 0; j < 2; j++)
+            {
+                __m256 sum = acc[i][0][j];
+                for (std::size_t u = 1; u < KU; u++)
+                {
+                    sum = _mm256_add_ps(sum, acc[i][u][j]);
+                }
+                out[i][j] = _mm256_fmadd_ps(scale[j], sum, out[i][j]);
+                if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+                {
+                    out[i][j] = _mm256_fmadd_ps(bias[j], _mm256_set1_ps(args.a_block_sum[(m0 + i) * blocks_per_row + blk]), out[i][j]);
+                }
+            }
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, out);
+}
+
+using micro_tile_fn = void(*)(const args_t&, std::size_t, std::size_t, std::size_t, std::size_t, bool);
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+struct per_element_panel
+{
+    static constexpr micro_tile_fn tiles[MR] =
+    {
+        micro_tile<1, BLOCK_SIZE, FORMAT>, micro_tile<2, BLOCK_SIZE, FORMAT>, micro_tile<3, BLOCK_SIZE, FORMAT>, micro_tile<4, BLOCK_SIZE, FORMAT>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += MR)
+        {
+            const std::size_t mr = (m_count - m) < MR ? (m_count - m) : MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+struct folded_panel
+{
+    static constexpr micro_tile_fn tiles[FOLDED_MR] =
+    {
+        folded_tile<1, BLOCK_SIZE, FORMAT>, folded_tile<2, BLOCK_SIZE, FORMAT>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += FOLDED_MR)
+        {
+            const std::size_t mr = (m_count - m) < FOLDED_MR ? (m_count - m) : FOLDED_MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+
+// A DOT_GROUP of panel rows (integer layout) as unsigned bytes, 32 bit lane j of w[h] holds column 8 * h + j.
+// 4 bit values are widened in registers: the low nibbles are columns 0-7, the high nibbles 8-15.
+template<WEIGHTS_FORMAT FORMAT>
+inline void load_dot_group(const std::uint8_t* src, __m256i w[2])
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        w[0] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        w[1] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+    }
+    else
+    {
+        const __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        w[0] = _mm256_and_si256(packed, mask);
+        w[1] = _mm256_and_si256(_mm256_srli_epi16(packed, 4), mask);
+    }
+}
+
+// acc += sum of the 4 products unsigned w x signed a of every 32 bit lane. vpmaddubsw saturates its 16 bit pair sums,
+// so the unsigned int8 weights are split into nibbles: w = 16 * hi + lo.
+template<WEIGHTS_FORMAT FORMAT>
+inline __m256i dot_accumulate(__m256i acc, __m256i w, __m256i a)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        const __m256i lo = _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_and_si256(w, mask), a), ones);
+        const __m256i hi = _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_and_si256(_mm256_srli_epi16(w, 4), mask), a), ones);
+        return _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_slli_epi32(hi, 4), lo));
+    }
+    else
+    {
+        return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(w, a), ones));
+    }
+}
+
+// the zero point row of the record, or the constant offset of the symmetric formats
+template<WEIGHTS_FORMAT FORMAT>
+inline void load_dot_zero_point(const std::uint8_t* record, __m256i zero_point[2])
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+    {
+        const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(record + PANEL_ZERO_POINT_OFFSET));
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        zero_point[0] = _mm256_cvtepu8_epi32(_mm_and_si128(packed, mask));
+        zero_point[1] = _mm256_cvtepu8_epi32(_mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+    }
+    else
+    {
+        zero_point[0] = _mm256_set1_epi32(dot_offset(FORMAT));
+        zero_point[1] = zero_point[0];
+    }
+}
+
+// 2 rows x 2 halves of int32 dot products + 2 x 2 outputs + weights fit the 16 ymm registers
+constexpr std::size_t INT8_MR = 2;
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+void int8_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t group_bytes = DOT_GROUP * panel_row_bytes(FORMAT);
+    const std::size_t blocks_per_row = args.K / block_size;
+
+    __m256 out[mr][2];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        for (std::size_t j = 0; j < 2; j++)
+        {
+            out[i][j] = accumulate ? _mm256_loadu_ps(c + (m0 + i) * args.ldc + j * 8) : _mm256_setzero_ps();
+        }
+    }
+
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        __m256i acc[mr][2];
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            acc[i][0] = _mm256_setzero_si256();
+            acc[i][1] = _mm256_setzero_si256();
+        }
+
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        const std::int8_t* a = args.a_q + m0 * args.K + k;
+        for (std::size_t g = 0; g < block_size / DOT_GROUP; g++)
+        {
+            _mm_prefetch(reinterpret_cast<const char*>(q + g * group_bytes + PREFETCH_DISTANCE), _MM_HINT_T0);
+            __m256i w[2];
+            load_dot_group<FORMAT>(q + g * group_bytes, w);
+            for (std::size_t i = 0; i < mr; i++)
+            {
+                const __m256i av = _mm256_set1_epi32(_mm_cvtsi128_si32(_mm_loadu_si32(a + i * args.K + g * DOT_GROUP)));
+                acc[i][0] = dot_accumulate<FORMAT>(acc[i][0], w[0], av);
+                acc[i][1] = dot_accumulate<FORMAT>(acc[i][1], w[1], av);
+            }
+        }
+
+        // out += a_scale * scale * (sum(a_q * q) - zero_point * sum(a_q))
+        __m256 scale[2];
+        __m256i zero_point[2];
+        load_scale<WEIGHTS_FORMAT_INT8>(record, scale);
+        load_dot_zero_point<FORMAT>(record, zero_point);
+        const std::size_t blk = k / block_size;
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            const std::size_t idx = (m0 + i) * blocks_per_row + blk;
+            const __m256i a_sum = _mm256_set1_epi32(args.a_q_block_sum[idx]);
+            const __m256 a_scale = _mm256_set1_ps(args.a_scale[idx]);
+            for (std::size_t j = 0; j < 2; j++)
+            {
+                const __m256i sum = _mm256_sub_epi32(acc[i][j], _mm256_mullo_epi32(zero_point[j], a_sum));
+                out[i][j] = _mm256_fmadd_ps(_mm256_mul_ps(scale[j], a_scale), _mm256_cvtepi32_ps(sum), out[i][j]);
+            }
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, out);
+}
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+struct int8_panel
+{
+    static constexpr micro_tile_fn tiles[INT8_MR] =
+    {
+        int8_tile<1, BLOCK_SIZE, FORMAT>, int8_tile<2, BLOCK_SIZE, FORMAT>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += INT8_MR)
+        {
+            const std::size_t mr = (m_count - m) < INT8_MR ? (m_count - m) : INT8_MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+
+// Bit planes of the DOT_GROUP rows in every 32 bit lane of the integer layout: the 4 x 4 bit matrix (row r, bit b) of each nibble is transposed
+// by two delta swaps, so byte b of the lane holds plane b: the low nibble indexes column j, the high nibble column j + 8.
+inline __m256i transpose_bit_planes(__m256i x)
+{
+    // (r, b) <-> (r + 2, b - 2) for r < 2, b >= 2, then (r, b) <-> (r + 1, b - 1) for even r, odd b
+    __m256i t = _mm256_and_si256(_mm256_xor_si256(_mm256_srli_epi32(x, 14), x), _mm256_set1_epi32(0x0000cccc));
+    x = _mm256_xor_si256(x, _mm256_xor_si256(t, _mm256_slli_epi32(t, 14)));
+    t = _mm256_and_si256(_mm256_xor_si256(_mm256_srli_epi32(x, 7), x), _mm256_set1_epi32(0x00aa00aa));
+    return _mm256_xor_si256(x, _mm256_xor_si256(t, _mm256_slli_epi32(t, 7)));
+}
+
+// 2 rows x 4 accumulators + the plane indices, tables and constants fit the 16 ymm registers
+constexpr std::size_t LUT_MR = 2;
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+void lut_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t group_bytes = DOT_GROUP * panel_row_bytes(FORMAT);
+    const std::size_t blocks_per_row = args.K / block_size;
+    // byte b of every lane weights the lookup of plane b by 2^b
+    const __m256i plane_weights = _mm256_set1_epi32(0x08040201);
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    __m256 out[mr][2];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        for (std::size_t j = 0; j < 2; j++)
+        {
+            out[i][j] = accumulate ? _mm256_loadu_ps(c + (m0 + i) * args.ldc + j * 8) : _mm256_setzero_ps();
+        }
+    }
+
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        // [columns 0-7, columns 8-15][low, high table bytes]
+        __m256i acc[mr][4];
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            for (std::size_t u = 0; u < 4; u++)
+            {
+                acc[i][u] = _mm256_setzero_si256();
+            }
+        }
+
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        for (std::size_t g = 0; g < block_size / DOT_GROUP; g++)
+        {
+            _mm_prefetch(reinterpret_cast<const char*>(q + g * group_bytes + PREFETCH_DISTANCE), _MM_HINT_T0);
+            const __m256i planes = transpose_bit_planes(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + g * group_bytes)));
+            const __m256i idx_lo = _mm256_and_si256(planes, mask);
+            const __m256i idx_hi = _mm256_and_si256(_mm256_srli_epi16(planes, 4), mask);
+            for (std::size_t i = 0; i < mr; i++)
+            {
+                const std::uint8_t* table = args.a_lut + ((m0 + i) * args.K + k) / DOT_GROUP * LUT_TABLE_BYTES + g * LUT_TABLE_BYTES;
+                const __m256i table_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+                const __m256i table_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16)));
+                acc[i][0] = dot_accumulate<FORMAT>(acc[i][0], _mm256_shuffle_epi8(table_lo, idx_lo), plane_weights);
+                acc[i][1] = dot_accumulate<FORMAT>(acc[i][1], plane_weights, _mm256_shuffle_epi8(table_hi, idx_lo));
+                acc[i][2] = dot_accumulate<FORMAT>(acc[i][2], _mm256_shuffle_epi8(table_lo, idx_hi), plane_weights);
+                acc[i][3] = dot_accumulate<FORMAT>(acc[i][3], plane_weights, _mm256_shuffle_epi8(table_hi, idx_hi));
+            }
+        }
+
+        // out += a_scale * scale * (sum(a_q * q) - zero_point * sum(a_q))
+        __m256 scale[2];
+        __m256i zero_point[2];
+        load_scale<WEIGHTS_FORMAT_INT8>(record, scale);
+        load_dot_zero_point<FORMAT>(record, zero_point);
+        const std::size_t blk = k / block_size;
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            const std::size_t idx = (m0 + i) * blocks_per_row + blk;
+            const __m256i a_sum = _mm256_set1_epi32(args.a_q_block_sum[idx]);
+            const __m256 a_scale = _mm256_set1_ps(args.a_scale[idx]);
+            for (std::size_t j = 0; j < 2; j++)
+            {
+                const __m256i dot = _mm256_add_epi32(acc[i][2 * j], _mm256_slli_epi32(acc[i][2 * j + 1], 8));
+                const __m256i sum = _mm256_sub_epi32(dot, _mm256_mullo_epi32(zero_point[j], a_sum));
+                out[i][j] = _mm256_fmadd_ps(_mm256_mul_ps(scale[j], a_scale), _mm256_cvtepi32_ps(sum), out[i][j]);
+            }
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, out);
+}
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+struct lut_panel
+{
+    static constexpr micro_tile_fn tiles[LUT_MR] =
+    {
+        lut_tile<1, BLOCK_SIZE, FORMAT>, lut_tile<2, BLOCK_SIZE, FORMAT>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += LUT_MR)
+        {
+            const std::size_t mr = (m_count - m) < LUT_MR ? (m_count - m) : LUT_MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_panel_kernel_avx2(std::size_t block_size, WEIGHTS_FORMAT format, DEQUANTIZATION dequantization)
+{
+    return dequantization == DEQUANTIZATION_FOLDED ? select_instantiation<folded_panel>(block_size, format) : select_instantiation<per_element_panel>(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_int8_panel_kernel_avx2(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<int8_panel>(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_lut_panel_kernel_avx2(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<lut_panel>(block_size, format);
+}
+#endif  // #if defined(_M_X64) || defined(__x86_64__)
@@ -0,0 +1,274 @@
+#include "cpu_quantized_gemm_kernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include "cpu_quantized_gemm_avx512.h"
+
+namespace
+{
+// Panel rows -> 16 x fp32, one lane per column: q for the integer formats, the code's value for WEIGHTS_FORMAT_LUT4.
+// to_weights() converts 16 bytes, one per column.
+template<WEIGHTS_FORMAT FORMAT>
+inline __m512 to_weights(__m128i bytes, __m512 lut)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT4 || FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(bytes));
+    }
+    else if constexpr (FORMAT == WEIGHTS_FORMAT_LUT4)
+    {
+        return _mm512_permutexvar_ps(_mm512_cvtepu8_epi32(bytes), lut);
+    }
+    else
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes));
+    }
+}
+
+template<WEIGHTS_FORMAT FORMAT>
+inline __m512 load_panel_row(const std::uint8_t* src, __m512 lut)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        return to_weights<FORMAT>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), lut);
+    }
+    else
+    {
+        __m256i lo, hi;
+        split_nibbles<FORMAT>(_mm256_castsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))), lo, hi);
+        return to_weights<FORMAT>(_mm256_castsi256_si128(_mm256_unpacklo_epi64(lo, hi)), lut);
+    }
+}
+
+// four panel rows, the nibble split is shared by the rows
+template<WEIGHTS_FORMAT FORMAT>
+inline void load_panel_rows4(const std::uint8_t* src, __m512 w[4], __m512 lut)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        for (std::size_t r = 0; r < 4; r++)
+        {
+            w[r] = load_panel_row<FORMAT>(src + r * PANEL_WIDTH, lut);
+        }
+    }
+    else
+    {
+        __m256i lo, hi;
+        split_nibbles<FORMAT>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)), lo, hi);
+        const __m256i rows_02 = _mm256_unpacklo_epi64(lo, hi);
+        const __m256i rows_13 = _mm256_unpackhi_epi64(lo, hi);
+        w[0] = to_weights<FORMAT>(_mm256_castsi256_si128(rows_02), lut);
+        w[1] = to_weights<FORMAT>(_mm256_castsi256_si128(rows_13), lut);
+        w[2] = to_weights<FORMAT>(_mm256_extracti128_si256(rows_02, 1), lut);
+        w[3] = to_weights<FORMAT>(_mm256_extracti128_si256(rows_13, 1), lut);
+    }
+}
+
+template<WEIGHTS_FORMAT FORMAT>
+inline __m512 load_lut(const args_t& args)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_LUT4)
+    {
+        return _mm512_loadu_ps(args.lut);
+    }
+    else
+    {
+        return _mm512_setzero_ps();
+    }
+}
+
+template<WEIGHTS_FORMAT FORMAT>
+inline __m512 load_scale(const std::uint8_t* record)
+{
+    const __m512 scale = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(record)));
+    return FORMAT == WEIGHTS_FORMAT_INT4 ? _mm512_mul_ps(scale, _mm512_set1_ps(1.0f / 16.0f)) : scale;
+}
+
+// -zero_point * scale of the record, zero point formats only
+inline __m512 load_bias(const std::uint8_t* record, __m512 scale)
+{
+    constexpr auto format = WEIGHTS_FORMAT_UINT4_ZERO_POINT;
+    return _mm512_fnmadd_ps(load_panel_row<format>(record + PANEL_ZERO_POINT_OFFSET, _mm512_setzero_ps()), scale, _mm512_setzero_ps());
+}
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+void micro_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t row_bytes = panel_row_bytes(FORMAT);
+    __m512 acc[mr];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        acc[i] = accumulate ? _mm512_loadu_ps(c + (m0 + i) * args.ldc) : _mm512_setzero_ps();
+    }
+
+    const __m512 lut = load_lut<FORMAT>(args);
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        // w = q * scale + bias with a zero point, so dequantization is a single fma, q * scale without
+        const __m512 scale = load_scale<FORMAT>(record);
+        const __m512 bias = FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT ? load_bias(record, scale) : _mm512_setzero_ps();
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        const float* a = args.a + m0 * args.K + k;
+        for (std::size_t kk = 0; kk < block_size; kk++)
+        {
+            const __m512 q_row = load_panel_row<FORMAT>(q + kk * row_bytes, lut);
+            const __m512 w = FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT ? _mm512_fmadd_ps(q_row, scale, bias) : _mm512_mul_ps(q_row, scale);
+            for (std::size_t i = 0; i < mr; i++)
+            {
+                acc[i] = _mm512_fmadd_ps(_mm512_set1_ps(a[i * args.K + kk]), w, acc[i]);
+            }
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, acc);
+}
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+void folded_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t row_bytes = panel_row_bytes(FORMAT);
+    // with few rows the fma chains are latency bound, independent accumulators over k keep the fma ports busy
+    constexpr std::size_t KU = mr <= 2 ? 4 : (mr <= 4 ? 2 : 1);
+    const std::size_t blocks_per_row = args.K / block_size;
+
+    __m512 out[mr];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        out[i] = accumulate ? _mm512_loadu_ps(c + (m0 + i) * args.ldc) : _mm512_setzero_ps();
+    }
+
+    const __m512 lut = load_lut<FORMAT>(args);
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        __m512 acc[mr][KU];
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            for (std::size_t u = 0; u < KU; u++)
+            {
+                acc[i][u] = _mm512_setzero_ps();
+            }
+        }
+
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        const float* a = args.a + m0 * args.K + k;
+        std::size_t kk = 0;
+        for (; kk + 4 <= block_size; kk += 4)
+        {
+            _mm_prefetch(reinterpret_cast<const char*>(q + kk * row_bytes + PREFETCH_DISTANCE), _MM_HINT_T0);
+            __m512 w[4];
+            load_panel_rows4<FORMAT>(q + kk * row_bytes, w, lut);
+            for (std::size_t r = 0; r < 4; r++)
+            {
+                for (std::size_t i = 0; i < mr; i++)
+                {
+                    acc[i][r % KU] = _mm512_fmadd_ps(_mm512_set1_ps(a[i * args.K + kk + r]), w[r], acc[i][r % KU]);
+                }
+            }
+        }
+        // the specialized block sizes are multiples of the unroll, only the generic kernel has a tail
+        if constexpr (BLOCK_SIZE == 0 || BLOCK_SIZE % 4 != 0)
+        {
+            for (; kk < block_size; kk++)
+            {
+                const __m512 w = load_panel_row<FORMAT>(q + kk * row_bytes, lut);
+                for (std::size_t i = 0; i < mr; i++)
+                {
+                    acc[i][0] = _mm512_fmadd_ps(_mm512_set1_ps(a[i * args.K + kk]), w, acc[i][0]);
+                }
+            }
+        }
+
+        // out += scale * sum(a * q) (+ bias * sum(a), bias = -zero_point * scale)
+        const __m512 scale = load_scale<FORMAT>(record);
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            __m512 sum = acc[i][0];
+            for (std::size_t u = 1; u < KU; u++)
+            {
+                sum = _mm512_add_ps(sum, acc[i][u]);
+            }
+            out[i] = _mm512_fmadd_ps(scale, sum, out[i]);
+        }
+        if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+        {
+            const __m512 bias = load_bias(record, scale);
+            const std::size_t blk = k / block_size;
+            for (std::size_t i = 0; i < mr; i++)
+            {
+                out[i] = _mm512_fmadd_ps(bias, _mm512_set1_ps(args.a_block_sum[(m0 + i) * blocks_per_row + blk]), out[i]);
+            }
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, out);
+}
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+struct per_element_panel
+{
+    static constexpr micro_tile_fn tiles[MR] =
+    {
+        micro_tile<1, BLOCK_SIZE, FORMAT>, micro_tile<2, BLOCK_SIZE, FORMAT>, micro_tile<3, BLOCK_SIZE, FORMAT>, micro_tile<4, BLOCK_SIZE, FORMAT>,
+        micro_tile<5, BLOCK_SIZE, FORMAT>, micro_tile<6, BLOCK_SIZE, FORMAT>, micro_tile<7, BLOCK_SIZE, FORMAT>, micro_tile<8, BLOCK_SIZE, FORMAT>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += MR)
+        {
+            const std::size_t mr = (m_count - m) < MR ? (m_count - m) : MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+struct folded_panel
+{
+    static constexpr micro_tile_fn tiles[MR] =
+    {
+        folded_tile<1, BLOCK_SIZE, FORMAT>, folded_tile<2, BLOCK_SIZE, FORMAT>, folded_tile<3, BLOCK_SIZE, FORMAT>, folded_tile<4, BLOCK_SIZE, FORMAT>,
+        folded_tile<5, BLOCK_SIZE, FORMAT>, folded_tile<6, BLOCK_SIZE, FORMAT>, folded_tile<7, BLOCK_SIZE, FORMAT>, folded_tile<8, BLOCK_SIZE, FORMAT>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += MR)
+        {
+            const std::size_t mr = (m_count - m) < MR ? (m_count - m) : MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+using int8_panel_madd = int8_panel<BLOCK_SIZE, FORMAT, false>;
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+using lut_panel_madd = lut_panel<BLOCK_SIZE, FORMAT, false>;
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_panel_kernel_avx512(std::size_t block_size, WEIGHTS_FORMAT format, DEQUANTIZATION dequantization)
+{
+    return dequantization == DEQUANTIZATION_FOLDED ? select_instantiation<folded_panel>(block_size, format) : select_instantiation<per_element_panel>(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_int8_panel_kernel_avx512(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<int8_panel_madd>(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_lut_panel_kernel_avx512(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<lut_panel_madd>(block_size, format);
+}
+#endif  // #if defined(_M_X64) || defined(__x86_64__)
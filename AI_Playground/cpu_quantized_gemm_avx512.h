@@ -0,0 +1,370 @@
+#pragma once
+// Helpers and the integer kernels shared by the AVX-512 translation units (cpu_quantized_gemm_avx512*.cpp), which are built with different
+// target flags: everything lives in an unnamed namespace, so every translation unit compiles its own copy. Include on x86-64 only.
+#include "cpu_quantized_gemm_kernels.h"
+
+#include <immintrin.h>
+
+namespace
+{
+using namespace cpu::kernels;
+using args_t = quantized_gemm_args_t;
+
+// one zmm covers the whole panel, 8 accumulators
+constexpr std::size_t MR = 8;
+
+// The 4 bit formats hold columns 0-7 in the low nibbles and 8-15 in the high nibbles.
+// int4 nibbles are moved to the high half of their byte, so they keep their sign as int8: the value is 16 x q, load_scale() compensates.
+template<WEIGHTS_FORMAT FORMAT>
+inline void split_nibbles(__m256i packed, __m256i& lo, __m256i& hi)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT4)
+    {
+        const __m256i mask = _mm256_set1_epi8(static_cast<char>(0xf0));
+        lo = _mm256_and_si256(_mm256_slli_epi16(packed, 4), mask);
+        hi = _mm256_and_si256(packed, mask);
+    }
+    else
+    {
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        lo = _mm256_and_si256(packed, mask);
+        hi = _mm256_and_si256(_mm256_srli_epi16(packed, 4), mask);
+    }
+}
+
+// e^x, Cephes polynomial on x - n * ln(2) scaled by 2^n, relative error ~1e-7 over the clamped range
+inline __m512 exp_ps(__m512 x)
+{
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-87.3f)), _mm512_set1_ps(88.3f));
+    const __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), r);
+    __m512 p = _mm512_set1_ps(1.9875691500e-4f);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.3981999507e-3f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(8.3334519073e-3f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(4.1665795894e-2f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.6666665459e-1f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(5.0000001201e-1f));
+    p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+    return _mm512_scalef_ps(p, n);
+}
+
+// x * sigmoid(z) = x / (1 + e^-z)
+inline __m512 mul_sigmoid(__m512 x, __m512 z)
+{
+    return _mm512_div_ps(x, _mm512_add_ps(_mm512_set1_ps(1.0f), exp_ps(_mm512_sub_ps(_mm512_setzero_ps(), z))));
+}
+
+inline __m512 activate(__m512 x, ACTIVATION activation)
+{
+    switch (activation)
+    {
+    case ACTIVATION_GELU:
+    {
+        const __m512 x3 = _mm512_mul_ps(_mm512_mul_ps(x, x), x);
+        return mul_sigmoid(x, _mm512_mul_ps(_mm512_set1_ps(1.5957691216f), _mm512_fmadd_ps(_mm512_set1_ps(0.044715f), x3, x)));
+    }
+    case ACTIVATION_SILU: return mul_sigmoid(x, x);
+    default: return x;
+    }
+}
+
+// Finished row m of a tile: post-ops on the accumulator and a masked store of the N - n0 valid columns of OUT.
+inline void store_output_row(const epilogue_args_t& epilogue, std::size_t m, std::size_t n0, __m512 x)
+{
+    const std::size_t columns = epilogue.N - n0 < PANEL_WIDTH ? epilogue.N - n0 : PANEL_WIDTH;
+    const __mmask16 mask = static_cast<__mmask16>((1u << columns) - 1);
+    if (epilogue.bias)
+    {
+        x = _mm512_add_ps(x, _mm512_loadu_ps(epilogue.bias + n0));
+    }
+    x = activate(x, epilogue.activation);
+    if (epilogue.residual_rows)
+    {
+        x = _mm512_add_ps(x, _mm512_cvtph_ps(_mm256_maskz_loadu_epi16(mask, epilogue.residual_rows[m] + n0)));
+    }
+    if (epilogue.requantize)
+    {
+        const __m512i q = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(epilogue.output_scale_inv)));
+        _mm512_mask_cvtsepi32_storeu_epi8(static_cast<std::int8_t*>(epilogue.out_rows[m]) + n0, mask, q);
+    }
+    else
+    {
+        _mm256_mask_storeu_epi16(static_cast<std::uint16_t*>(epilogue.out_rows[m]) + n0, mask, _mm512_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+}
+
+// c rows of the tile, or OUT rows when this call completes K
+template<std::size_t mr>
+inline void store_tile(const args_t& args, std::size_t m0, std::size_t panel, float* c, std::size_t k_end, const __m512 (&acc)[mr])
+{
+    if (args.epilogue && k_end == args.K)
+    {
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            store_output_row(*args.epilogue, m0 + i, panel * PANEL_WIDTH, acc[i]);
+        }
+        return;
+    }
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        _mm512_storeu_ps(c + (m0 + i) * args.ldc, acc[i]);
+    }
+}
+
+// Bytes ahead of the current row the folded and integer kernels prefetch: with a few rows of A, B is streamed once and the prefetch hides DRAM latency.
+constexpr std::size_t PREFETCH_DISTANCE = 1024;
+
+using micro_tile_fn = void(*)(const args_t&, std::size_t, std::size_t, std::size_t, std::size_t, bool);
+
+// 64 unsigned bytes of a DOT_GROUP of panel rows (integer layout), 32 bit lane j holds column j. 4 bit values are widened in registers:
+// the low nibbles are columns 0-7, the high nibbles 8-15.
+template<WEIGHTS_FORMAT FORMAT>
+inline __m512i load_dot_group(const std::uint8_t* src)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+    {
+        return _mm512_loadu_si512(src);
+    }
+    else
+    {
+        const __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        const __m256i lo = _mm256_and_si256(packed, mask);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(packed, 4), mask);
+        return _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+    }
+}
+
+// acc += sum of the 4 products unsigned w x signed a of every 32 bit lane
+template<bool VNNI, WEIGHTS_FORMAT FORMAT>
+inline __m512i dot_accumulate(__m512i acc, __m512i w, __m512i a)
+{
+    if constexpr (VNNI)
+    {
+        return _mm512_dpbusd_epi32(acc, w, a);
+    }
+    else
+    {
+        const __m512i ones = _mm512_set1_epi16(1);
+        if constexpr (FORMAT == WEIGHTS_FORMAT_INT8)
+        {
+            // w = 16 * hi + lo
+            const __m512i mask = _mm512_set1_epi8(0x0f);
+            const __m512i lo = _mm512_madd_epi16(_mm512_maddubs_epi16(_mm512_and_si512(w, mask), a), ones);
+            const __m512i hi = _mm512_madd_epi16(_mm512_maddubs_epi16(_mm512_and_si512(_mm512_srli_epi16(w, 4), mask), a), ones);
+            return _mm512_add_epi32(acc, _mm512_add_epi32(_mm512_slli_epi32(hi, 4), lo));
+        }
+        else
+        {
+            return _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_maddubs_epi16(w, a), ones));
+        }
+    }
+}
+
+// the zero point row of the record, or the constant offset of the symmetric formats
+template<WEIGHTS_FORMAT FORMAT>
+inline __m512i load_dot_zero_point(const std::uint8_t* record)
+{
+    if constexpr (FORMAT == WEIGHTS_FORMAT_UINT4_ZERO_POINT)
+    {
+        __m256i lo, hi;
+        split_nibbles<FORMAT>(_mm256_castsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(record + PANEL_ZERO_POINT_OFFSET))), lo, hi);
+        return _mm512_cvtepu8_epi32(_mm256_castsi256_si128(_mm256_unpacklo_epi64(lo, hi)));
+    }
+    else
+    {
+        return _mm512_set1_epi32(dot_offset(FORMAT));
+    }
+}
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT, bool VNNI>
+void int8_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t group_bytes = DOT_GROUP * panel_row_bytes(FORMAT);
+    // the dot product chains of a few rows are latency bound, independent accumulators over k hide it
+    constexpr std::size_t KU = mr <= 2 ? 4 : (mr <= 4 ? 2 : 1);
+    const std::size_t blocks_per_row = args.K / block_size;
+
+    __m512 out[mr];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        out[i] = accumulate ? _mm512_loadu_ps(c + (m0 + i) * args.ldc) : _mm512_setzero_ps();
+    }
+
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        __m512i acc[mr][KU];
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            for (std::size_t u = 0; u < KU; u++)
+            {
+                acc[i][u] = _mm512_setzero_si512();
+            }
+        }
+
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        const std::int8_t* a = args.a_q + m0 * args.K + k;
+        for (std::size_t g = 0; g < block_size / DOT_GROUP; g++)
+        {
+            _mm_prefetch(reinterpret_cast<const char*>(q + g * group_bytes + PREFETCH_DISTANCE), _MM_HINT_T0);
+            const __m512i w = load_dot_group<FORMAT>(q + g * group_bytes);
+            for (std::size_t i = 0; i < mr; i++)
+            {
+                const __m512i av = _mm512_set1_epi32(_mm_cvtsi128_si32(_mm_loadu_si32(a + i * args.K + g * DOT_GROUP)));
+                acc[i][g % KU] = dot_accumulate<VNNI, FORMAT>(acc[i][g % KU], w, av);
+            }
+        }
+
+        // out += a_scale * scale * (sum(a_q * q) - zero_point * sum(a_q))
+        const __m512 scale = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(record)));
+        const __m512i zero_point = load_dot_zero_point<FORMAT>(record);
+        const std::size_t blk = k / block_size;
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            __m512i sum = acc[i][0];
+            for (std::size_t u = 1; u < KU; u++)
+            {
+                sum = _mm512_add_epi32(sum, acc[i][u]);
+            }
+            const std::size_t idx = (m0 + i) * blocks_per_row + blk;
+            sum = _mm512_sub_epi32(sum, _mm512_mullo_epi32(zero_point, _mm512_set1_epi32(args.a_q_block_sum[idx])));
+            out[i] = _mm512_fmadd_ps(_mm512_mul_ps(scale, _mm512_set1_ps(args.a_scale[idx])), _mm512_cvtepi32_ps(sum), out[i]);
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, out);
+}
+
+// Bit planes of the DOT_GROUP rows in every 32 bit lane of the integer layout: the 4 x 4 bit matrix (row r, bit b) of each nibble is transposed
+// by two delta swaps, so byte b of the lane holds plane b: the low nibble indexes column j, the high nibble column j + 8.
+inline __m512i transpose_bit_planes(__m512i x)
+{
+    // (r, b) <-> (r + 2, b - 2) for r < 2, b >= 2, then (r, b) <-> (r + 1, b - 1) for even r, odd b
+    __m512i t = _mm512_ternarylogic_epi32(_mm512_srli_epi32(x, 14), x, _mm512_set1_epi32(0x0000cccc), 0x28);
+    x = _mm512_ternarylogic_epi32(x, t, _mm512_slli_epi32(t, 14), 0x96);
+    t = _mm512_ternarylogic_epi32(_mm512_srli_epi32(x, 7), x, _mm512_set1_epi32(0x00aa00aa), 0x28);
+    return _mm512_ternarylogic_epi32(x, t, _mm512_slli_epi32(t, 7), 0x96);
+}
+
+// 4 rows of A per LUT tile, 4 accumulators each
+constexpr std::size_t LUT_MR = 4;
+
+template<std::size_t mr, std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT, bool VNNI>
+void lut_tile(const args_t& args, std::size_t m0, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+{
+    const std::uint8_t* b = args.b + panel * args.panel_stride;
+    float* c = args.c + panel * PANEL_WIDTH;
+    const std::size_t block_size = BLOCK_SIZE != 0 ? BLOCK_SIZE : args.block_size;
+    constexpr std::size_t group_bytes = DOT_GROUP * panel_row_bytes(FORMAT);
+    const std::size_t groups = block_size / DOT_GROUP;
+    const std::size_t blocks_per_row = args.K / block_size;
+    // byte b of every lane weights the lookup of plane b by 2^b
+    const __m512i plane_weights = _mm512_set1_epi32(0x08040201);
+    const __m512i mask = _mm512_set1_epi8(0x0f);
+
+    __m512 out[mr];
+    for (std::size_t i = 0; i < mr; i++)
+    {
+        out[i] = accumulate ? _mm512_loadu_ps(c + (m0 + i) * args.ldc) : _mm512_setzero_ps();
+    }
+
+    const std::size_t block_bytes = panel_block_bytes(block_size, FORMAT);
+    const std::uint8_t* record = b + (k0 / block_size) * block_bytes;
+    for (std::size_t k = k0; k < k0 + k_count; k += block_size, record += block_bytes)
+    {
+        // [columns 0-7, columns 8-15][low, high table bytes], the 256 bit halves hold 2 consecutive groups
+        __m512i acc[mr][4];
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            for (std::size_t u = 0; u < 4; u++)
+            {
+                acc[i][u] = _mm512_setzero_si512();
+            }
+        }
+
+        const std::uint8_t* q = record + panel_weights_offset(FORMAT);
+        for (std::size_t g = 0; g < groups; g += 2)
+        {
+            // an odd last group reads zeros for the second one: plane index 0 looks up T[0] = 0
+            const __mmask8 load_mask = g + 1 < groups ? 0xff : 0x0f;
+            _mm_prefetch(reinterpret_cast<const char*>(q + g * group_bytes + PREFETCH_DISTANCE), _MM_HINT_T0);
+            const __m512i planes = transpose_bit_planes(_mm512_maskz_loadu_epi64(load_mask, q + g * group_bytes));
+            const __m512i idx_lo = _mm512_and_si512(planes, mask);
+            const __m512i idx_hi = _mm512_and_si512(_mm512_srli_epi16(planes, 4), mask);
+            for (std::size_t i = 0; i < mr; i++)
+            {
+                // the 128 bit lanes of a group share its table
+                const __m512i tables = _mm512_maskz_loadu_epi64(load_mask, args.a_lut + ((m0 + i) * args.K + k) / DOT_GROUP * LUT_TABLE_BYTES + g * LUT_TABLE_BYTES);
+                const __m512i table_lo = _mm512_shuffle_i64x2(tables, tables, _MM_SHUFFLE(2, 2, 0, 0));
+                const __m512i table_hi = _mm512_shuffle_i64x2(tables, tables, _MM_SHUFFLE(3, 3, 1, 1));
+                acc[i][0] = dot_accumulate<VNNI, FORMAT>(acc[i][0], _mm512_shuffle_epi8(table_lo, idx_lo), plane_weights);
+                acc[i][1] = dot_accumulate<VNNI, FORMAT>(acc[i][1], plane_weights, _mm512_shuffle_epi8(table_hi, idx_lo));
+                acc[i][2] = dot_accumulate<VNNI, FORMAT>(acc[i][2], _mm512_shuffle_epi8(table_lo, idx_hi), plane_weights);
+                acc[i][3] = dot_accumulate<VNNI, FORMAT>(acc[i][3], plane_weights, _mm512_shuffle_epi8(table_hi, idx_hi));
+            }
+        }
+
+        // out += a_scale * scale * (sum(a_q * q) - zero_point * sum(a_q))
+        const __m512 scale = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(record)));
+        const __m512i zero_point = load_dot_zero_point<FORMAT>(record);
+        const std::size_t blk = k / block_size;
+        for (std::size_t i = 0; i < mr; i++)
+        {
+            const __m512i cols_lo = _mm512_add_epi32(acc[i][0], _mm512_slli_epi32(acc[i][1], 8));
+            const __m512i cols_hi = _mm512_add_epi32(acc[i][2], _mm512_slli_epi32(acc[i][3], 8));
+            const __m256i sum_lo = _mm256_add_epi32(_mm512_castsi512_si256(cols_lo), _mm512_extracti64x4_epi64(cols_lo, 1));
+            const __m256i sum_hi = _mm256_add_epi32(_mm512_castsi512_si256(cols_hi), _mm512_extracti64x4_epi64(cols_hi, 1));
+            __m512i sum = _mm512_inserti64x4(_mm512_castsi256_si512(sum_lo), sum_hi, 1);
+            const std::size_t idx = (m0 + i) * blocks_per_row + blk;
+            sum = _mm512_sub_epi32(sum, _mm512_mullo_epi32(zero_point, _mm512_set1_epi32(args.a_q_block_sum[idx])));
+            out[i] = _mm512_fmadd_ps(_mm512_mul_ps(scale, _mm512_set1_ps(args.a_scale[idx])), _mm512_cvtepi32_ps(sum), out[i]);
+        }
+    }
+
+    store_tile<mr>(args, m0, panel, c, k0 + k_count, out);
+}
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT, bool VNNI>
+struct lut_panel
+{
+    static constexpr micro_tile_fn tiles[LUT_MR] =
+    {
+        lut_tile<1, BLOCK_SIZE, FORMAT, VNNI>, lut_tile<2, BLOCK_SIZE, FORMAT, VNNI>, lut_tile<3, BLOCK_SIZE, FORMAT, VNNI>, lut_tile<4, BLOCK_SIZE, FORMAT, VNNI>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += LUT_MR)
+        {
+            const std::size_t mr = (m_count - m) < LUT_MR ? (m_count - m) : LUT_MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT, bool VNNI>
+struct int8_panel
+{
+    static constexpr micro_tile_fn tiles[MR] =
+    {
+        int8_tile<1, BLOCK_SIZE, FORMAT, VNNI>, int8_tile<2, BLOCK_SIZE, FORMAT, VNNI>, int8_tile<3, BLOCK_SIZE, FORMAT, VNNI>, int8_tile<4, BLOCK_SIZE, FORMAT, VNNI>,
+        int8_tile<5, BLOCK_SIZE, FORMAT, VNNI>, int8_tile<6, BLOCK_SIZE, FORMAT, VNNI>, int8_tile<7, BLOCK_SIZE, FORMAT, VNNI>, int8_tile<8, BLOCK_SIZE, FORMAT, VNNI>,
+    };
+
+    static void run(const args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate)
+    {
+        for (std::size_t m = 0; m < m_count; m += MR)
+        {
+            const std::size_t mr = (m_count - m) < MR ? (m_count - m) : MR;
+            tiles[mr - 1](args, m0 + m, panel, k0, k_count, accumulate);
+        }
+    }
+};
+
+}
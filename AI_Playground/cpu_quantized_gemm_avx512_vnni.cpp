@@ -0,0 +1,24 @@
+#include "cpu_quantized_gemm_kernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include "cpu_quantized_gemm_avx512.h"
+
+namespace
+{
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+using int8_panel_vnni = int8_panel<BLOCK_SIZE, FORMAT, true>;
+
+template<std::size_t BLOCK_SIZE, WEIGHTS_FORMAT FORMAT>
+using lut_panel_vnni = lut_panel<BLOCK_SIZE, FORMAT, true>;
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_int8_panel_kernel_avx512_vnni(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<int8_panel_vnni>(block_size, format);
+}
+
+cpu::kernels::panel_kernel_fn cpu::kernels::select_lut_panel_kernel_avx512_vnni(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return select_instantiation<lut_panel_vnni>(block_size, format);
+}
+#endif  // #if defined(_M_X64) || defined(__x86_64__)
@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// ISA specific kernels of cpu::quantized_gemm, every *_<isa>.cpp file is built with its own target flags.
+// Keep the standard library out of these translation units, so no inline function gets emitted with wider instructions than the caller expects.
+namespace cpu::kernels
+{
+// How a panel stores the weights, the quantization schemes (quant::SCHEME) map onto these. Every format has its own kernel instantiations.
+enum WEIGHTS_FORMAT
+{
+    WEIGHTS_FORMAT_UINT4_ZERO_POINT,    // uint4 q and a uint4 zero point row per record: scale * (q - zero_point)
+    WEIGHTS_FORMAT_INT4,                // int4 q, symmetric: scale * q
+    WEIGHTS_FORMAT_INT8,                // int8 q, symmetric: scale * q
+    WEIGHTS_FORMAT_LUT4,                // uint4 codes: scale * args.lut[q]
+    // ..
+    WEIGHTS_FORMAT_COUNT
+};
+
+// Prepacked B: PANEL_WIDTH columns per panel, every panel is K / block_size records of
+//   scale[PANEL_WIDTH] fp16 | zero_point[PANEL_WIDTH] uint4 (WEIGHTS_FORMAT_UINT4_ZERO_POINT only) | q[block_size][PANEL_WIDTH]
+// so a block's quantization params sit right before its weights and a panel is one contiguous stream.
+// A row of PANEL_WIDTH 4 bit values is 8 bytes, byte j holds column j (low nibble) and column j + 8 (high nibble).
+// A row of int8 values is 16 bytes in column order. Columns past N are zero padded.
+constexpr std::size_t PANEL_WIDTH = 16;
+constexpr std::size_t PANEL_ROW_BYTES = PANEL_WIDTH / 2;
+constexpr std::size_t PANEL_ZERO_POINT_OFFSET = PANEL_WIDTH * sizeof(std::uint16_t);
+constexpr std::size_t PANEL_ALIGNMENT = 64;
+
+constexpr std::size_t panel_row_bytes(WEIGHTS_FORMAT format)
+{
+    return format == WEIGHTS_FORMAT_INT8 ? PANEL_WIDTH : PANEL_ROW_BYTES;
+}
+
+constexpr std::size_t panel_weights_offset(WEIGHTS_FORMAT format)
+{
+    return PANEL_ZERO_POINT_OFFSET + (format == WEIGHTS_FORMAT_UINT4_ZERO_POINT ? PANEL_ROW_BYTES : 0);
+}
+
+constexpr std::size_t panel_block_bytes(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    return panel_weights_offset(format) + block_size * panel_row_bytes(format);
+}
+
+constexpr std::size_t panel_bytes(std::size_t K, std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    const std::size_t bytes = (K / block_size) * panel_block_bytes(block_size, format);
+    return (bytes + PANEL_ALIGNMENT - 1) / PANEL_ALIGNMENT * PANEL_ALIGNMENT;
+}
+
+// Panels of the integer dot product kernels (int8 activations) keep the record layout above, only the q rows are reordered for
+// instructions multiplying DOT_GROUP consecutive elements of K per 32 bit lane (VNNI vpdpbusd: unsigned B x signed A):
+//   4 bit formats: 32 bytes per group of 4 rows, byte 4 * j + r holds (row r, column j) in its low nibble and (row r, column j + 8) in its high nibble
+//   WEIGHTS_FORMAT_INT8: 64 bytes per group of 4 rows, byte 4 * j + r is (row r, column j)
+// q is stored unsigned, offset by dot_offset(): the kernels subtract (zero_point or offset) * sum(a) from the int32 dot products.
+// WEIGHTS_FORMAT_LUT4 has no integer path.
+constexpr std::size_t DOT_GROUP = 4;
+
+constexpr std::uint8_t dot_offset(WEIGHTS_FORMAT format)
+{
+    return format == WEIGHTS_FORMAT_INT8 ? 128 : (format == WEIGHTS_FORMAT_INT4 ? 8 : 0);
+}
+
+// Post-ops of epilogue::desc_t, applied by the kernel call that completes a tile's K range to its accumulators:
+// + bias, activation, + residual, then the rows of OUT are stored directly as fp16 or saturated int8 (c isn't written).
+enum ACTIVATION
+{
+    ACTIVATION_NONE,
+    ACTIVATION_GELU,    // tanh approximation, x * sigmoid(2 * sqrt(2 / pi) * (x + 0.044715 * x^3))
+    ACTIVATION_SILU,
+};
+
+struct epilogue_args_t
+{
+    const float* bias = nullptr;                            // [ldc], zero padded, nullptr without bias
+    const std::uint16_t* const* residual_rows = nullptr;    // fp16 row m of the residual, N columns, nullptr without residual
+    void* const* out_rows = nullptr;                        // row m of OUT, N fp16 or int8 columns
+    std::size_t N = 0;
+    ACTIVATION activation = ACTIVATION_NONE;
+    bool requantize = false;                                // int8 = saturate(round(x * output_scale_inv)), fp16 otherwise
+    float output_scale_inv = 1.0f;
+};
+
+struct quantized_gemm_args_t
+{
+    const float* a = nullptr;               // M x K
+    const float* a_block_sum = nullptr;     // M x (K / block_size), sums of A over every quantization block, read by the folded kernels of zero point formats
+    const std::uint8_t* b = nullptr;        // prepacked panels, panel_stride bytes apart
+    const float* lut = nullptr;             // values of the 16 codes of WEIGHTS_FORMAT_LUT4
+    // int8 activations, read by the integer kernels instead of a
+    const std::int8_t* a_q = nullptr;           // M x K
+    const float* a_scale = nullptr;             // M x (K / block_size), scale of A over every panel record
+    const std::int32_t* a_q_block_sum = nullptr;    // M x (K / block_size), sums of a_q over every panel record
+    const std::uint8_t* a_lut = nullptr;        // M x (K / DOT_GROUP) x LUT_TABLE_BYTES, tables of a_q read by the LUT kernels
+    float* c = nullptr;                     // M x ldc, ldc is a multiple of PANEL_WIDTH
+    const epilogue_args_t* epilogue = nullptr;  // the calls with k0 + k_count == K store OUT through it instead of c, nullptr keeps fp32 partials in c
+
+    std::size_t K = 0;
+    std::size_t ldc = 0;
+    std::size_t block_size = 0;             // rows of a panel record
+    std::size_t panel_stride = 0;
+};
+
+// c[m0:m0+m_count, panel columns] (+)= a[m0:m0+m_count, k0:k0+k_count] x dequantize(B panel)
+// k0 and k_count are multiples of block_size, the dequantized B never leaves registers. The last K chunk goes through args.epilogue when set.
+using panel_kernel_fn = void(*)(const quantized_gemm_args_t& args, std::size_t m0, std::size_t m_count, std::size_t panel, std::size_t k0, std::size_t k_count, bool accumulate);
+
+// Where the quantization params of B are applied by the fp32 kernels:
+//   DEQUANTIZATION_PER_ELEMENT: every weight is dequantized in the inner loop (scale * q - scale * zero_point, one fma) and multiplied by a
+//   DEQUANTIZATION_FOLDED: the inner loop is a pure multiply-accumulate of a and the raw q, a block is folded once as
+//     scale * sum(a * q) - scale * zero_point * sum(a), the zero point term is a rank-1 correction by args.a_block_sum
+enum DEQUANTIZATION
+{
+    DEQUANTIZATION_PER_ELEMENT,
+    DEQUANTIZATION_FOLDED,
+};
+
+// The kernels are instantiated per weights format and quantization block size: the symmetric formats skip the zero point entirely,
+// BLOCK_SIZE 16, 32, 64 and 128 have constant trip counts in the per-block loops, so they unroll and the block's quantization params
+// are loaded once outside of them. BLOCK_SIZE 0 reads args.block_size at runtime.
+panel_kernel_fn select_panel_kernel_scalar(std::size_t block_size, WEIGHTS_FORMAT format, DEQUANTIZATION dequantization);
+panel_kernel_fn select_panel_kernel_avx2(std::size_t block_size, WEIGHTS_FORMAT format, DEQUANTIZATION dequantization);
+panel_kernel_fn select_panel_kernel_avx512(std::size_t block_size, WEIGHTS_FORMAT format, DEQUANTIZATION dequantization);
+
+// Decode-style shapes, a few rows of A (M <= GEMV_MAX_M), are bound by streaming B once.
+constexpr std::size_t GEMV_MAX_M = 8;
+
+// The integer kernels: c (+)= a_scale * scale * (sum(a_q * q) - zero_point * sum(a_q)) per record, the int32 dot products are exact and the
+// combined scale is applied once per record. block_size is a multiple of DOT_GROUP. Without VNNI the dot products go through
+// vpmaddubsw + vpmaddwd, the unsigned int8 weights are split into nibbles first so the 16 bit pair sums can't saturate.
+panel_kernel_fn select_int8_panel_kernel_scalar(std::size_t block_size, WEIGHTS_FORMAT format);
+panel_kernel_fn select_int8_panel_kernel_avx2(std::size_t block_size, WEIGHTS_FORMAT format);
+panel_kernel_fn select_int8_panel_kernel_avx512(std::size_t block_size, WEIGHTS_FORMAT format);
+panel_kernel_fn select_int8_panel_kernel_avx512_vnni(std::size_t block_size, WEIGHTS_FORMAT format);
+
+// The LUT kernels (T-MAC): the same contract and result as the integer kernels, for the 4 bit integer formats, without multiplies by q.
+// The q of a DOT_GROUP of rows are split into bit planes: plane b of column j is the 4 bit index sum_r bit_b(q[r][j]) << r, so
+//   sum_r a_q[r] * q[r][j] = sum_b 2^b * T[plane b of column j],   T[p] = sum of a_q[r] over the bits r set in p
+// T is built once per call for every DOT_GROUP of A and read with byte shuffles (vpshufb), the 16 planes of a group are found by
+// transposing the 4 x 4 bits of every nibble of the integer layout in registers, so both engines run on the same prepacked weights.
+// T is int16 (|T| <= 4 * 128), stored as its low bytes (unsigned) followed by its high bytes (signed) to fit the byte shuffles.
+constexpr std::size_t LUT_TABLE_BYTES = 2 * 16;
+
+panel_kernel_fn select_lut_panel_kernel_scalar(std::size_t block_size, WEIGHTS_FORMAT format);
+panel_kernel_fn select_lut_panel_kernel_avx2(std::size_t block_size, WEIGHTS_FORMAT format);
+panel_kernel_fn select_lut_panel_kernel_avx512(std::size_t block_size, WEIGHTS_FORMAT format);
+panel_kernel_fn select_lut_panel_kernel_avx512_vnni(std::size_t block_size, WEIGHTS_FORMAT format);
+
+// KERNEL<BLOCK_SIZE, FORMAT>::run of the runtime block size and format, shared by the selectors of every ISA.
+template<template<std::size_t, WEIGHTS_FORMAT> typename KERNEL, std::size_t BLOCK_SIZE>
+panel_kernel_fn select_format_instantiation(WEIGHTS_FORMAT format)
+{
+    switch (format)
+    {
+    case WEIGHTS_FORMAT_INT4: return KERNEL<BLOCK_SIZE, WEIGHTS_FORMAT_INT4>::run;
+    case WEIGHTS_FORMAT_INT8: return KERNEL<BLOCK_SIZE, WEIGHTS_FORMAT_INT8>::run;
+    case WEIGHTS_FORMAT_LUT4: return KERNEL<BLOCK_SIZE, WEIGHTS_FORMAT_LUT4>::run;
+    default: return KERNEL<BLOCK_SIZE, WEIGHTS_FORMAT_UINT4_ZERO_POINT>::run;
+    }
+}
+
+template<template<std::size_t, WEIGHTS_FORMAT> typename KERNEL>
+panel_kernel_fn select_instantiation(std::size_t block_size, WEIGHTS_FORMAT format)
+{
+    switch (block_size)
+    {
+    case 16: return select_format_instantiation<KERNEL, 16>(format);
+    case 32: return select_format_instantiation<KERNEL, 32>(format);
+    case 64: return select_format_instantiation<KERNEL, 64>(format);
+    case 128: return select_format_instantiation<KERNEL, 128>(format);
+    default: return select_format_instantiation<KERNEL, 0>(format);
+    }
+}
+}
@@ -0,0 +1,224 @@
+#include "cpu_quantized_gemm_tuner.h"
+#include "cpu_context.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+constexpr std::string_view TUNING_CACHE_MAGIC = "AIPG-TUNING";
+
+// "<cpu model>\t<key fields>\t<config fields>", see cpu::TuningCache
+bool parse_entry(const std::string& line, cpu::tuning_key_t& key, cpu::quantized_gemm_config_t& config)
+{
+    const auto tab0 = line.find('\t');
+    const auto tab1 = tab0 == std::string::npos ? std::string::npos : line.find('\t', tab0 + 1);
+    if (tab1 == std::string::npos)
+    {
+        return false;
+    }
+    key.cpu_model = line.substr(0, tab0);
+
+    std::istringstream key_fields(line.substr(tab0 + 1, tab1 - tab0 - 1));
+    std::string isa{};
+    std::string quantization{};
+    std::string dynamic_quantization{};
+    key_fields >> isa >> key.threads_count >> key.M >> key.K >> key.N >> key.block_size >> quantization >> dynamic_quantization;
+    if (!key_fields || !cpu::from_string(isa, key.isa) || !quant::from_string(quantization, key.quantization)
+        || !quant::from_string(dynamic_quantization, key.dynamic_quantization))
+    {
+        return false;
+    }
+
+    std::istringstream config_fields(line.substr(tab1 + 1));
+    std::string dequantization{};
+    std::string engine{};
+    config_fields >> dequantization >> engine >> config.mc >> config.nc_panels >> config.kc >> config.threads;
+    return config_fields && cpu::from_string(dequantization, config.dequantization) && cpu::from_string(engine, config.engine);
+}
+}
+
+cpu::tuning_key_t cpu::make_tuning_key(const CpuContext& ctx, const quantized_gemm_desc_t& desc)
+{
+    tuning_key_t key{};
+    key.cpu_model = get_cpu_model();
+    key.isa = ctx.get_isa();
+    key.threads_count = ctx.get_threads_count();
+    key.M = desc.M;
+    key.K = desc.K;
+    key.N = desc.N;
+    key.block_size = quant::get_block_size(desc.quantization, desc.K, desc.block_size);
+    key.quantization = desc.quantization;
+    key.dynamic_quantization = desc.dynamic_quantization;
+    return key;
+}
+
+bool cpu::TuningCache::load(const std::filesystem::path& path)
+{
+    entries_.clear();
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "[TuningCache] " << path << ": can't open." << std::endl;
+        return false;
+    }
+    std::string line{};
+    std::getline(file, line);
+    std::istringstream header(line);
+    std::string magic{};
+    std::uint32_t version = 0;
+    header >> magic >> version;
+    if (magic != TUNING_CACHE_MAGIC)
+    {
+        std::cerr << "[TuningCache] " << path << ": not a tuning cache file." << std::endl;
+        return false;
+    }
+    if (version != TUNING_CACHE_VERSION)
+    {
+        std::cerr << "[TuningCache] " << path << ": unsupported version " << version << ", expected " << TUNING_CACHE_VERSION << "." << std::endl;
+        return false;
+    }
+    for (std::size_t line_idx = 2; std::getline(file, line); line_idx++)
+    {
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+        tuning_key_t key{};
+        quantized_gemm_config_t config{};
+        if (!parse_entry(line, key, config))
+        {
+            std::cerr << "[TuningCache] " << path << ":" << line_idx << ": malformed entry." << std::endl;
+            entries_.clear();
+            return false;
+        }
+        entries_[key] = config;
+    }
+    return true;
+}
+
+bool cpu::TuningCache::save(const std::filesystem::path& path) const
+{
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        file << TUNING_CACHE_MAGIC << " " << TUNING_CACHE_VERSION << "\n"
+            << "# cpu model\tisa threads_count M K N block_size quantization dynamic_quantization\tdequantization engine mc nc_panels kc threads\n";
+        for (const auto& [key, config] : entries_)
+        {
+            file << key.cpu_model << "\t"
+                << to_string(key.isa) << " " << key.threads_count << " " << key.M << " " << key.K << " " << key.N << " " << key.block_size << " "
+                << quant::to_string(key.quantization) << " " << quant::to_string(key.dynamic_quantization) << "\t"
+                << to_string(config.dequantization) << " " << to_string(config.engine) << " "
+                << config.mc << " " << config.nc_panels << " " << config.kc << " " << config.threads << "\n";
+        }
+        if (!file)
+        {
+            std::cerr << "[TuningCache] " << tmp_path << ": write failed." << std::endl;
+            return false;
+        }
+    }
+    std::error_code ec{};
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        std::cerr << "[TuningCache] " << path << ": can't replace, " << ec.message() << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+const cpu::quantized_gemm_config_t* cpu::TuningCache::find(const tuning_key_t& key) const
+{
+    const auto it = entries_.find(key);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+void cpu::TuningCache::insert(const tuning_key_t& key, const quantized_gemm_config_t& config)
+{
+    entries_[key] = config;
+}
+
+cpu::quantized_gemm_config_t cpu::tune_quantized_gemm(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::uint32_t M,
+    const tune_params_t& params)
+{
+    // fp16 1.0, the values don't matter for timing
+    const std::vector<std::uint16_t> a(std::size_t(M) * weights.K, 0x3c00);
+    std::vector<std::uint16_t> out(std::size_t(M) * weights.N);
+    const auto time_ms = [&](const quantized_gemm_config_t& config)
+    {
+        const auto run = [&]() { quantized_gemm(ctx, weights, M, std::as_bytes(std::span(a)), std::as_writable_bytes(std::span(out)), {}, {}, config); };
+        for (std::size_t i = 0; i < params.warmup_iters; i++)
+        {
+            run();
+        }
+        std::vector<double> samples_ms(std::max<std::size_t>(params.timed_iters, 1));
+        for (auto& sample : samples_ms)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            sample = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::nth_element(samples_ms.begin(), samples_ms.begin() + samples_ms.size() / 2, samples_ms.end());
+        return samples_ms[samples_ms.size() / 2];
+    };
+
+    auto best = resolve_config(ctx, weights, M, {});
+    double best_ms = time_ms(best);
+    // Candidates are resolved first, so the values a shape can't use collapse onto configs that were already timed.
+    std::vector<quantized_gemm_config_t> timed{ best };
+    const auto sweep = [&](const std::vector<quantized_gemm_config_t>& candidates)
+    {
+        for (const auto& candidate : candidates)
+        {
+            const auto resolved = resolve_config(ctx, weights, M, candidate);
+            if (std::find(timed.begin(), timed.end(), resolved) != timed.end())
+            {
+                continue;
+            }
+            timed.push_back(resolved);
+            const double ms = time_ms(resolved);
+            if (ms < best_ms * (1.0 - params.min_gain))
+            {
+                best = resolved;
+                best_ms = ms;
+            }
+        }
+    };
+    const auto sweep_field = [&](std::uint32_t quantized_gemm_config_t::* field, std::initializer_list<std::uint32_t> values)
+    {
+        std::vector<quantized_gemm_config_t> candidates(values.size(), best);
+        std::size_t i = 0;
+        for (const auto value : values)
+        {
+            candidates[i++].*field = value;
+        }
+        sweep(candidates);
+    };
+
+    std::vector<quantized_gemm_config_t> kernels{};
+    for (const auto dequantization : { DEQUANTIZATION_PER_ELEMENT, DEQUANTIZATION_FOLDED })
+    {
+        for (const auto engine : { ENGINE_MULTIPLY, ENGINE_LUT })
+        {
+            kernels.push_back(best);
+            kernels.back().dequantization = dequantization;
+            kernels.back().engine = engine;
+        }
+    }
+    sweep(kernels);
+    sweep_field(&quantized_gemm_config_t::kc, { 64, 128, 256, 512, 1024, 2048, 4096, weights.K });
+    sweep_field(&quantized_gemm_config_t::nc_panels, { 1, 2, 4, 8, 16 });
+    sweep_field(&quantized_gemm_config_t::mc, { 8, 16, 32, 64, 128, 256 });
+    const std::uint32_t threads_count = ctx.get_threads_count();
+    sweep_field(&quantized_gemm_config_t::threads, { threads_count, threads_count * 3 / 4, threads_count / 2, threads_count / 4, threads_count / 8, 1 });
+    return best;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "cpu_isa.h"
+#include "cpu_quantized_gemm.h"
+
+#include <compare>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <string>
+
+namespace cpu
+{
+// Shape a tuned quantized_gemm_config_t is valid for. The CPU model keeps apart the entries of different hosts sharing a cache file,
+// the blocking and the workers of a call are tuned for the threads of the context.
+struct tuning_key_t
+{
+    std::string cpu_model;
+    ISA isa = ISA_SCALAR;
+    std::uint32_t threads_count = 0;    // of the context
+    std::uint32_t M = 0;
+    std::uint32_t K = 0;
+    std::uint32_t N = 0;
+    std::uint32_t block_size = 0;   // of the quantization, K for per channel schemes
+    quant::SCHEME quantization = quant::SCHEME_UINT4_ASYMMETRIC;
+    quant::DYNAMIC_QUANTIZATION dynamic_quantization = quant::DYNAMIC_QUANTIZATION_NONE;
+
+    auto operator<=>(const tuning_key_t&) const = default;
+};
+
+// The key of the calls with desc.M rows on the host running ctx.
+tuning_key_t make_tuning_key(const CpuContext& ctx, const quantized_gemm_desc_t& desc);
+
+// Tuned configs of every shape, persisted as a text file:
+//   AIPG-TUNING <TUNING_CACHE_VERSION>
+//   <cpu model> TAB <isa> <threads_count> <M> <K> <N> <block_size> <quantization> <dynamic quantization> TAB <dequantization> <engine> <mc> <nc_panels> <kc> <threads>
+// one entry per line, enums by their to_string() names, lines starting with '#' are comments.
+// Bump the version when the kernels change enough to invalidate the measurements, files of other versions are dropped as a whole.
+constexpr std::uint32_t TUNING_CACHE_VERSION = 2;
+
+class TuningCache
+{
+public:
+    // Both return false and print the reason on failure, a failed load leaves the cache empty.
+    // The file is written next to path and renamed over it, entries of other hosts loaded before are kept.
+    bool load(const std::filesystem::path& path);
+    bool save(const std::filesystem::path& path) const;
+
+    // nullptr when the shape wasn't tuned
+    const quantized_gemm_config_t* find(const tuning_key_t& key) const;
+    void insert(const tuning_key_t& key, const quantized_gemm_config_t& config);
+    std::size_t size() const { return entries_.size(); }
+
+private:
+    std::map<tuning_key_t, quantized_gemm_config_t> entries_;
+};
+
+struct tune_params_t
+{
+    std::size_t warmup_iters = 2;
+    std::size_t timed_iters = 7;    // per candidate, the median counts
+    double min_gain = 0.03;         // a candidate has to be faster by this fraction to replace the best, so timing noise doesn't pick configs
+};
+
+// Times candidate configs of a call with M rows on the context and returns the fastest, resolved (see resolve_config()).
+// Coordinate descent from the default config: the kernels (dequantization and engine), then kc, nc_panels, mc and threads,
+// every step sweeps one of them and keeps the best value for the next ones.
+quantized_gemm_config_t tune_quantized_gemm(const CpuContext& ctx, const quantized_gemm_weights_t& weights, std::uint32_t M,
+    const tune_params_t& params = {});
+}
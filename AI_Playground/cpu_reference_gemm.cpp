@@ -0,0 +1,232 @@
+#include "cpu_reference_gemm.h"
+#include "cpu_context.h"
+#include "float16.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace
+{
+// Tile of OUT owned by one task. A, B and the accumulators of a tile fit in L2 (64 + 64 + 32 KB with fp64 accumulators).
+constexpr std::uint32_t MB = 64;
+constexpr std::uint32_t NB = 64;
+constexpr std::uint32_t KB = 256;
+// register block of the inner loop
+constexpr std::uint32_t MR = 4;
+constexpr std::uint32_t NR = 16;
+
+inline std::uint8_t get_uint4(const std::uint8_t* data, std::size_t idx)
+{
+    const std::uint8_t byte = data[idx / 2];
+    return (idx & 1) ? (byte >> 4) : (byte & 0xf);
+}
+
+struct reference_args_t
+{
+    const cpu::reference_quantized_gemm_desc_t& desc;
+    std::uint32_t block_size;   // of the quantization, K for per channel schemes
+    const float* lut;           // lookup table schemes
+    const fp16::float16_t* a;
+    const float* a_dequantized; // [M, K] with dynamic quantization, nullptr otherwise
+    const std::uint8_t* b;
+    const fp16::float16_t* b_scale;
+    const std::uint8_t* b_zero_point;
+    const fp16::float16_t* bias;
+    const fp16::float16_t* residual;
+    std::byte* out;
+    // element strides of B and its quantization params along N and K, they cover both layouts of B
+    std::size_t b_n_stride;
+    std::size_t b_k_stride;
+    std::size_t q_n_stride;
+    std::size_t q_k_stride;
+};
+
+// B element idx before scaling, the zero point isn't subtracted
+inline float get_weight(const reference_args_t& args, std::size_t idx)
+{
+    switch (args.desc.quantization)
+    {
+    case quant::SCHEME_INT4_SYMMETRIC: return float(static_cast<std::int8_t>(get_uint4(args.b, idx) << 4) >> 4);
+    case quant::SCHEME_INT8_PER_CHANNEL: return float(static_cast<std::int8_t>(args.b[idx]));
+    case quant::SCHEME_NF4:
+    case quant::SCHEME_FP4: return args.lut[get_uint4(args.b, idx)];
+    default: return float(get_uint4(args.b, idx));
+    }
+}
+
+template<typename acc_t>
+void reference_tile(const reference_args_t& args, std::uint32_t m0, std::uint32_t mb, std::uint32_t n0, std::uint32_t nb)
+{
+    const std::uint32_t K = args.desc.K;
+
+    // edge tiles are zero padded, so the loops below have constant trip counts and vectorize
+    acc_t acc[MB][NB]{};
+    float a_tile[MB][KB]{};
+    float b_tile[KB][NB]{};
+    for (std::uint32_t k0 = 0; k0 < K; k0 += KB)
+    {
+        const std::uint32_t kb = std::min(KB, K - k0);
+        // dequantization is exact in fp32 for the integer schemes (fp16 scale times an integer of at most 8 bits), lookup tables round once
+        for (std::uint32_t n = 0; n < nb; n++)
+        {
+            for (std::uint32_t k = 0; k < kb;)
+            {
+                const std::uint32_t block_idx = (k0 + k) / args.block_size;
+                const std::uint32_t block_end = std::min(kb, (block_idx + 1) * args.block_size - k0);
+                const std::size_t q_idx = std::size_t(n0 + n) * args.q_n_stride + std::size_t(block_idx) * args.q_k_stride;
+                const float zp = quant::has_zero_point(args.desc.quantization) ? float(get_uint4(args.b_zero_point, q_idx)) : 0.0f;
+                const float scale = fp16::to_float(args.b_scale[q_idx]);
+                for (; k < block_end; k++)
+                {
+                    b_tile[k][n] = (get_weight(args, std::size_t(n0 + n) * args.b_n_stride + std::size_t(k0 + k) * args.b_k_stride) - zp) * scale;
+                }
+            }
+        }
+        for (std::uint32_t m = 0; m < mb; m++)
+        {
+            if (args.a_dequantized)
+            {
+                std::copy_n(args.a_dequantized + std::size_t(m0 + m) * K + k0, kb, a_tile[m]);
+            }
+            else
+            {
+                fp16::to_float(args.a + std::size_t(m0 + m) * K + k0, a_tile[m], kb);
+            }
+        }
+
+        // MR x NR block of accumulators stays in registers for the whole K chunk
+        for (std::uint32_t m = 0; m < mb; m += MR)
+        {
+            for (std::uint32_t n = 0; n < NB; n += NR)
+            {
+                acc_t c[MR][NR];
+                for (std::uint32_t i = 0; i < MR; i++)
+                {
+                    for (std::uint32_t j = 0; j < NR; j++)
+                    {
+                        c[i][j] = acc[m + i][n + j];
+                    }
+                }
+                for (std::uint32_t k = 0; k < kb; k++)
+                {
+                    for (std::uint32_t i = 0; i < MR; i++)
+                    {
+                        const acc_t a_value = a_tile[m + i][k];
+                        for (std::uint32_t j = 0; j < NR; j++)
+                        {
+                            c[i][j] += a_value * acc_t(b_tile[k][n + j]);
+                        }
+                    }
+                }
+                for (std::uint32_t i = 0; i < MR; i++)
+                {
+                    for (std::uint32_t j = 0; j < NR; j++)
+                    {
+                        acc[m + i][n + j] = c[i][j];
+                    }
+                }
+            }
+        }
+    }
+
+    const auto& epilogue = args.desc.epilogue;
+    for (std::uint32_t m = 0; m < mb; m++)
+    {
+        const std::size_t row_offset = std::size_t(m0 + m) * args.desc.N + n0;
+        float row[NB];
+        for (std::uint32_t n = 0; n < nb; n++)
+        {
+            float x = static_cast<float>(acc[m][n]) + (epilogue.bias ? fp16::to_float(args.bias[n0 + n]) : 0.0f);
+            x = epilogue::activate(epilogue.activation, x);
+            row[n] = x + (epilogue.residual ? fp16::to_float(args.residual[row_offset + n]) : 0.0f);
+        }
+        if (epilogue.requantize)
+        {
+            auto* out = reinterpret_cast<std::int8_t*>(args.out) + row_offset;
+            for (std::uint32_t n = 0; n < nb; n++)
+            {
+                out[n] = epilogue::requantize(row[n], epilogue.output_scale);
+            }
+        }
+        else
+        {
+            fp16::from_float(row, reinterpret_cast<fp16::float16_t*>(args.out) + row_offset, nb);
+        }
+    }
+}
+}
+
+void cpu::reference_quantized_gemm(const CpuContext& ctx, const reference_quantized_gemm_desc_t& desc,
+    std::span<const std::byte> a, std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point,
+    std::span<const std::byte> bias, std::span<const std::byte> residual, std::span<std::byte> out)
+{
+    const std::uint32_t block_size = quant::get_block_size(desc.quantization, desc.K, desc.block_size);
+    assert(block_size != 0 && desc.K % block_size == 0);
+    [[maybe_unused]] const std::size_t blocks_count = std::size_t(desc.N) * (desc.K / block_size);
+    assert(a.size() >= std::size_t(desc.M) * desc.K * sizeof(fp16::float16_t));
+    assert(b.size() >= tensor::get_size_in_bytes(quant::get_weights_data_type(desc.quantization), std::size_t(desc.N) * desc.K));
+    assert(b_scale.size() >= blocks_count * sizeof(fp16::float16_t));
+    assert(!quant::has_zero_point(desc.quantization) || b_zero_point.size() >= (blocks_count + 1) / 2);
+    assert(!desc.epilogue.bias || bias.size() >= desc.N * sizeof(fp16::float16_t));
+    assert(!desc.epilogue.residual || residual.size() >= std::size_t(desc.M) * desc.N * sizeof(fp16::float16_t));
+    assert(out.size() >= tensor::get_size_in_bytes(epilogue::get_output_data_type(desc.epilogue), std::size_t(desc.M) * desc.N));
+
+    // dynamic quantization is part of the operation: A is rounded to its int8 codes exactly as the backends do, then multiplied in fp32
+    std::vector<float> a_dequantized{};
+    if (desc.dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE)
+    {
+        const std::size_t K = desc.K;
+        const std::size_t group = desc.dynamic_quantization == quant::DYNAMIC_QUANTIZATION_INT8_PER_BLOCK ? block_size : K;
+        a_dequantized.resize(std::size_t(desc.M) * K);
+        ctx.parallel_for(desc.M, [&](std::size_t m, std::uint32_t)
+            {
+                float* row = a_dequantized.data() + m * K;
+                fp16::to_float(fp16::as_float16(a).data() + m * K, row, K);
+                std::vector<std::int8_t> q(group);
+                for (std::size_t k0 = 0; k0 < K; k0 += group)
+                {
+                    const float scale = quant::quantize_int8(row + k0, group, q.data());
+                    for (std::size_t k = 0; k < group; k++)
+                    {
+                        row[k0 + k] = q[k] * scale;
+                    }
+                }
+            });
+    }
+
+    const reference_args_t args{ desc,
+        block_size,
+        quant::get_lookup_table(desc.quantization),
+        fp16::as_float16(a).data(),
+        a_dequantized.empty() ? nullptr : a_dequantized.data(),
+        reinterpret_cast<const std::uint8_t*>(b.data()),
+        fp16::as_float16(b_scale).data(),
+        reinterpret_cast<const std::uint8_t*>(b_zero_point.data()),
+        fp16::as_float16(bias).data(),
+        fp16::as_float16(residual).data(),
+        out.data(),
+        desc.b_transposed ? desc.K : 1,
+        desc.b_transposed ? 1 : desc.N,
+        desc.b_transposed ? desc.K / block_size : 1,
+        desc.b_transposed ? 1 : desc.N };
+
+    // every output tile is owned by a single task, the K loop runs in the same order whatever the thread count
+    const std::uint32_t m_tiles = (desc.M + MB - 1) / MB;
+    const std::uint32_t n_tiles = (desc.N + NB - 1) / NB;
+    ctx.parallel_for(std::size_t(m_tiles) * n_tiles, [&](std::size_t task_idx, std::uint32_t)
+        {
+            const auto m0 = static_cast<std::uint32_t>(task_idx / n_tiles) * MB;
+            const auto n0 = static_cast<std::uint32_t>(task_idx % n_tiles) * NB;
+            const std::uint32_t mb = std::min(MB, desc.M - m0);
+            const std::uint32_t nb = std::min(NB, desc.N - n0);
+            if (desc.accumulation == REFERENCE_ACCUMULATION_FP64)
+            {
+                reference_tile<double>(args, m0, mb, n0, nb);
+            }
+            else
+            {
+                reference_tile<float>(args, m0, mb, n0, nb);
+            }
+        });
+}
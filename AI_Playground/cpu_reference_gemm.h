@@ -0,0 +1,40 @@
+#pragma once
+#include "epilogue.h"
+#include "quantization.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+namespace cpu
+{
+class CpuContext;
+
+enum REFERENCE_ACCUMULATION
+{
+    REFERENCE_ACCUMULATION_FP32,
+    REFERENCE_ACCUMULATION_FP64,
+};
+
+struct reference_quantized_gemm_desc_t
+{
+    std::uint32_t M = 0;
+    std::uint32_t K = 0;
+    std::uint32_t N = 0;
+    std::uint32_t block_size = 0;   // ignored by per channel schemes
+    bool b_transposed = true;   // B is [N, K], otherwise [K, N], see cpu_quantized_gemm.h
+    quant::SCHEME quantization = quant::SCHEME_UINT4_ASYMMETRIC;
+    quant::DYNAMIC_QUANTIZATION dynamic_quantization = quant::DYNAMIC_QUANTIZATION_NONE;
+    REFERENCE_ACCUMULATION accumulation = REFERENCE_ACCUMULATION_FP32;
+    epilogue::desc_t epilogue{};
+};
+
+// Host golden model of the quantized GEMM, same tensors and layouts as cpu::quantized_gemm (see cpu_quantized_gemm.h).
+// Plain C++ without ISA specific kernels: B is dequantized to fp32 and every output is accumulated in order along K,
+// so the result doesn't depend on the thread count or the machine. Cache-blocked and split across the context's threads.
+// With dynamic quantization A is first rounded to the int8 codes and scales of quant::quantize_int8(), as the integer kernels see it.
+// The epilogue runs on the fp32 result in the order of epilogue.h: bias[N] (fp16), activation, residual[M, N] (fp16), fp16 or int8 out.
+void reference_quantized_gemm(const CpuContext& ctx, const reference_quantized_gemm_desc_t& desc,
+    std::span<const std::byte> a, std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point,
+    std::span<const std::byte> bias, std::span<const std::byte> residual, std::span<std::byte> out);
+}
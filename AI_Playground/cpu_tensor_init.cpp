@@ -0,0 +1,160 @@
+#include "cpu_tensor_init.h"
+#include "cpu_context.h"
+#include "float16.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace
+{
+// Elements per task.
+constexpr std::size_t CHUNK_SIZE = 4096;
+
+// https://prng.di.unimi.it/splitmix64.c, used as a counter based generator: hashing (key + i) gives the i-th random number
+inline std::uint64_t splitmix64(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// [0, 1) with 24 random bits
+inline float to_unit_float(std::uint64_t bits)
+{
+    return static_cast<float>(bits >> 40) * 0x1.0p-24f;
+}
+
+// The standard library distributions are implementation defined, these only depend on libm rounding (normal).
+inline float sample(const cpu::distribution_t& distribution, std::uint64_t key, std::size_t idx, bool integer)
+{
+    const std::uint64_t bits = splitmix64(key + idx);
+    switch (distribution.type)
+    {
+    case cpu::DISTRIBUTION_UNIFORM:
+    {
+        const float range = distribution.p1 - distribution.p0 + (integer ? 1.0f : 0.0f);
+        const float value = distribution.p0 + to_unit_float(bits) * range;
+        return integer ? std::floor(value) : value;
+    }
+    case cpu::DISTRIBUTION_NORMAL:
+    {
+        // Box-Muller, u1 in (0, 1] keeps the log finite
+        const float u1 = 1.0f - to_unit_float(bits);
+        const float u2 = to_unit_float(splitmix64(bits));
+        const float value = distribution.p0 + distribution.p1 * std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+        return integer ? std::nearbyint(value) : value;
+    }
+    default:
+        return integer ? std::nearbyint(distribution.p0) : distribution.p0;
+    }
+}
+
+// 4 bit integers in [min, max], two's complement for negative ranges
+void fill_random_nibbles(const cpu::CpuContext& ctx, std::span<std::byte> data, const cpu::distribution_t& distribution, std::uint64_t seed, float min, float max)
+{
+    auto* u8 = reinterpret_cast<std::uint8_t*>(data.data());
+    const std::uint64_t key = splitmix64(seed);
+    // CHUNK_SIZE nibbles per task
+    const std::size_t chunk_bytes = CHUNK_SIZE / 2;
+    const std::size_t chunks_count = (data.size() + chunk_bytes - 1) / chunk_bytes;
+    ctx.parallel_for(chunks_count, [&](std::size_t chunk_idx, std::uint32_t)
+        {
+            const std::size_t begin = chunk_idx * chunk_bytes;
+            const std::size_t end = std::min(begin + chunk_bytes, data.size());
+            for (std::size_t i = begin; i < end; i++)
+            {
+                const auto lo = static_cast<std::uint8_t>(static_cast<int>(std::clamp(sample(distribution, key, 2 * i, true), min, max)) & 0x0f);
+                const auto hi = static_cast<std::uint8_t>(static_cast<int>(std::clamp(sample(distribution, key, 2 * i + 1, true), min, max)) & 0x0f);
+                u8[i] = static_cast<std::uint8_t>(lo | (hi << 4));
+            }
+        });
+}
+
+bool parse_float(std::string_view str, float& value)
+{
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    return ec == std::errc() && ptr == str.data() + str.size();
+}
+}
+
+bool cpu::from_string(std::string_view str, distribution_t& distribution)
+{
+    const auto colon = str.find(':');
+    if (colon == std::string_view::npos)
+    {
+        return false;
+    }
+    const std::string_view type = str.substr(0, colon);
+    const std::string_view values = str.substr(colon + 1);
+    const auto comma = values.find(',');
+
+    distribution_t ret{};
+    if (type == "constant")
+    {
+        ret.type = DISTRIBUTION_CONSTANT;
+        if (!parse_float(values, ret.p0))
+        {
+            return false;
+        }
+    }
+    else if (type == "uniform" || type == "normal")
+    {
+        ret.type = type == "uniform" ? DISTRIBUTION_UNIFORM : DISTRIBUTION_NORMAL;
+        if (comma == std::string_view::npos || !parse_float(values.substr(0, comma), ret.p0) || !parse_float(values.substr(comma + 1), ret.p1))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+    distribution = ret;
+    return true;
+}
+
+void cpu::fill_random_fp16(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed)
+{
+    const auto dst = fp16::as_float16(data);
+    const std::uint64_t key = splitmix64(seed);
+    const std::size_t chunks_count = (dst.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    ctx.parallel_for(chunks_count, [&](std::size_t chunk_idx, std::uint32_t)
+        {
+            const std::size_t begin = chunk_idx * CHUNK_SIZE;
+            const std::size_t count = std::min(CHUNK_SIZE, dst.size() - begin);
+            float values[CHUNK_SIZE];
+            for (std::size_t i = 0; i < count; i++)
+            {
+                values[i] = sample(distribution, key, begin + i, false);
+            }
+            fp16::from_float(values, dst.data() + begin, count);
+        });
+}
+
+void cpu::fill_random_uint4(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed)
+{
+    fill_random_nibbles(ctx, data, distribution, seed, 0.0f, 15.0f);
+}
+
+void cpu::fill_random_int4(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed)
+{
+    fill_random_nibbles(ctx, data, distribution, seed, -8.0f, 7.0f);
+}
+
+void cpu::fill_random_int8(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed)
+{
+    auto* u8 = reinterpret_cast<std::uint8_t*>(data.data());
+    const std::uint64_t key = splitmix64(seed);
+    const std::size_t chunks_count = (data.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    ctx.parallel_for(chunks_count, [&](std::size_t chunk_idx, std::uint32_t)
+        {
+            const std::size_t begin = chunk_idx * CHUNK_SIZE;
+            const std::size_t end = std::min(begin + CHUNK_SIZE, data.size());
+            for (std::size_t i = begin; i < end; i++)
+            {
+                u8[i] = static_cast<std::uint8_t>(static_cast<std::int8_t>(std::clamp(sample(distribution, key, i, true), -128.0f, 127.0f)));
+            }
+        });
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace cpu
+{
+class CpuContext;
+
+enum DISTRIBUTION
+{
+    DISTRIBUTION_CONSTANT,  // p0
+    DISTRIBUTION_UNIFORM,   // [p0, p1], integer tensors draw every integer of the range with the same probability
+    DISTRIBUTION_NORMAL,    // mean p0, standard deviation p1
+};
+
+struct distribution_t
+{
+    DISTRIBUTION type = DISTRIBUTION_CONSTANT;
+    float p0 = 0.0f;
+    float p1 = 0.0f;
+};
+
+// "constant:<v>", "uniform:<min>,<max>" or "normal:<mean>,<stddev>"
+bool from_string(std::string_view str, distribution_t& distribution);
+
+// Element i is a pure function of (seed, i): the tensors are filled in parallel on the context's threads
+// and the contents don't depend on the thread count. Use a different seed per tensor.
+void fill_random_fp16(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed);
+// Integer values are rounded and clamped to the range of the type, both nibbles of every byte are filled.
+void fill_random_uint4(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed);
+void fill_random_int4(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed);
+void fill_random_int8(const CpuContext& ctx, std::span<std::byte> data, const distribution_t& distribution, std::uint64_t seed);
+}
@@ -0,0 +1,147 @@
+#include "cpu_weights_file.h"
+#include "cpu_mapped_file.h"
+#include "tensor.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+inline std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+struct expected_sizes_t
+{
+    std::uint64_t b = 0;
+    std::uint64_t b_scale = 0;
+    std::uint64_t b_zero_point = 0;
+};
+
+inline expected_sizes_t expected_sizes(std::uint32_t K, std::uint32_t N, std::uint32_t block_size, quant::SCHEME quantization)
+{
+    const std::uint64_t blocks_count = K / block_size;
+    return {
+        tensor::make_desc(quant::get_weights_data_type(quantization), { N, K }).get_size_in_bytes(),
+        tensor::make_desc(tensor::DATA_TYPE_FP16, { N, blocks_count }).get_size_in_bytes(),
+        quant::has_zero_point(quantization) ? tensor::make_desc(tensor::DATA_TYPE_UINT4, { N, blocks_count }).get_size_in_bytes() : 0 };
+}
+
+bool get_section(std::span<const std::byte> file, std::uint64_t offset, std::uint64_t size, std::span<const std::byte>& section)
+{
+    if (offset % cpu::WEIGHTS_FILE_ALIGNMENT != 0 || offset > file.size() || size > file.size() - offset)
+    {
+        return false;
+    }
+    section = file.subspan(offset, size);
+    return true;
+}
+}
+
+bool cpu::write_weights_file(const std::filesystem::path& path, std::uint32_t K, std::uint32_t N, std::uint32_t block_size, quant::SCHEME quantization,
+    std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point)
+{
+    const auto sizes = block_size != 0 ? expected_sizes(K, N, block_size, quantization) : expected_sizes_t{};
+    if (block_size == 0 || K % block_size != 0 || (quant::is_per_channel(quantization) && block_size != K) || b.size() < sizes.b || b_scale.size() < sizes.b_scale || b_zero_point.size() < sizes.b_zero_point)
+    {
+        std::cerr << "[Weights] " << path << ": tensors don't match the shape K: " << K << ", N: " << N << ", block_size: " << block_size << std::endl;
+        return false;
+    }
+
+    weights_file_header_t header{};
+    header.K = K;
+    header.N = N;
+    header.block_size = block_size;
+    header.quantization = quantization;
+    header.b_offset = align_up(sizeof(header), WEIGHTS_FILE_ALIGNMENT);
+    header.b_size = sizes.b;
+    header.b_scale_offset = align_up(header.b_offset + header.b_size, WEIGHTS_FILE_ALIGNMENT);
+    header.b_scale_size = sizes.b_scale;
+    header.b_zero_point_offset = align_up(header.b_scale_offset + header.b_scale_size, WEIGHTS_FILE_ALIGNMENT);
+    header.b_zero_point_size = sizes.b_zero_point;
+
+    // The file at path may be mapped and in use (ex. the weights being saved were loaded from it), so it's written next to it and renamed over it:
+    // the mappings keep the pages of the previous file.
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        const auto write_at = [&](std::uint64_t offset, const void* data, std::uint64_t size)
+        {
+            // padding between the tensors is zero filled
+            static const char zeros[WEIGHTS_FILE_ALIGNMENT]{};
+            const auto pos = static_cast<std::uint64_t>(file.tellp());
+            file.write(zeros, offset - pos);
+            file.write(static_cast<const char*>(data), size);
+        };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_at(header.b_offset, b.data(), header.b_size);
+        write_at(header.b_scale_offset, b_scale.data(), header.b_scale_size);
+        write_at(header.b_zero_point_offset, b_zero_point.data(), header.b_zero_point_size);
+        if (!file)
+        {
+            std::cerr << "[Weights] " << tmp_path << ": write failed." << std::endl;
+            return false;
+        }
+    }
+    std::error_code ec{};
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        std::cerr << "[Weights] " << path << ": can't replace, " << ec.message() << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool cpu::map_weights_file(const std::filesystem::path& path, MappedFile& file, weights_file_view_t& view)
+{
+    if (!file.open(path))
+    {
+        return false;
+    }
+    const auto data = file.get_data();
+
+    weights_file_header_t& header = view.header;
+    const weights_file_header_t expected{};
+    if (data.size() < sizeof(header) || std::memcmp(data.data(), expected.magic, sizeof(expected.magic)) != 0)
+    {
+        std::cerr << "[Weights] " << path << ": not a weights file." << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version != 1 && header.version != WEIGHTS_FILE_VERSION)
+    {
+        std::cerr << "[Weights] " << path << ": unsupported version " << header.version << ", expected " << WEIGHTS_FILE_VERSION << "." << std::endl;
+        return false;
+    }
+    if (header.version == 1)
+    {
+        header.quantization = quant::SCHEME_UINT4_ASYMMETRIC;
+    }
+    if (header.quantization >= quant::SCHEME_COUNT)
+    {
+        std::cerr << "[Weights] " << path << ": unknown quantization scheme " << header.quantization << "." << std::endl;
+        return false;
+    }
+
+    const auto quantization = static_cast<quant::SCHEME>(header.quantization);
+    const auto sizes = header.block_size != 0 ? expected_sizes(header.K, header.N, header.block_size, quantization) : expected_sizes_t{};
+    if (header.block_size == 0 || header.K % header.block_size != 0
+        || header.b_size != sizes.b || header.b_scale_size != sizes.b_scale || header.b_zero_point_size != sizes.b_zero_point)
+    {
+        std::cerr << "[Weights] " << path << ": tensor sizes don't match the shape in the header." << std::endl;
+        return false;
+    }
+    if (!get_section(data, header.b_offset, header.b_size, view.b)
+        || !get_section(data, header.b_scale_offset, header.b_scale_size, view.b_scale)
+        || !get_section(data, header.b_zero_point_offset, header.b_zero_point_size, view.b_zero_point))
+    {
+        std::cerr << "[Weights] " << path << ": truncated or misaligned tensor data." << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "quantization.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace cpu
+{
+class MappedFile;
+
+// Quantized GEMM weights on disk: the header followed by B, scales and zero points in the layouts of cpu_quantized_gemm.h.
+// Every tensor starts on a WEIGHTS_FILE_ALIGNMENT boundary, integers are little endian. Symmetric schemes have an empty zero point section.
+// Version 1 files predate the quantization field and hold the asymmetric uint4 scheme.
+constexpr std::uint32_t WEIGHTS_FILE_VERSION = 2;
+constexpr std::size_t WEIGHTS_FILE_ALIGNMENT = 4096;
+
+struct weights_file_header_t
+{
+    char magic[8] = { 'A', 'I', 'P', 'G', 'Q', 'W', 'T', 'S' };
+    std::uint32_t version = WEIGHTS_FILE_VERSION;
+    std::uint32_t K = 0;
+    std::uint32_t N = 0;
+    std::uint32_t block_size = 0;
+
+    std::uint64_t b_offset = 0;
+    std::uint64_t b_size = 0;
+    std::uint64_t b_scale_offset = 0;
+    std::uint64_t b_scale_size = 0;
+    std::uint64_t b_zero_point_offset = 0;
+    std::uint64_t b_zero_point_size = 0;
+
+    std::uint32_t quantization = quant::SCHEME_UINT4_ASYMMETRIC;    // quant::SCHEME, since version 2
+};
+
+// Tensors of a weights file, they point into the file's mapping and are valid as long as it stays open.
+struct weights_file_view_t
+{
+    weights_file_header_t header{};
+    std::span<const std::byte> b;
+    std::span<const std::byte> b_scale;
+    std::span<const std::byte> b_zero_point;
+};
+
+// Both return false and print the reason on failure. Mapping validates the header and the tensor sizes against the shape.
+// block_size is the quantization block size, K for per channel schemes.
+// The file is written next to path and renamed over it, so processes mapping the previous file keep valid pages.
+bool write_weights_file(const std::filesystem::path& path, std::uint32_t K, std::uint32_t N, std::uint32_t block_size, quant::SCHEME quantization,
+    std::span<const std::byte> b, std::span<const std::byte> b_scale, std::span<const std::byte> b_zero_point);
+bool map_weights_file(const std::filesystem::path& path, MappedFile& file, weights_file_view_t& view);
+}
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <format>
 
+#if BUILD_DX12
 namespace
 {
 
@@ -212,6 +213,36 @@ ComPtr<IDMLBindingTable> dx12::Dx12Context::create_binding_table(const DML_BINDI
     return dml_binding_table;
 }
 
+dml::TensorDesc dx12::to_dml_tensor_desc(const tensor::desc_t& desc)
+{
+    constexpr std::uint32_t dml_rank = 4;
+    assert(desc.rank <= dml_rank);
+    DML_TENSOR_DATA_TYPE data_type = DML_TENSOR_DATA_TYPE_UNKNOWN;
+    switch (desc.data_type)
+    {
+    case tensor::DATA_TYPE_FP16: data_type = DML_TENSOR_DATA_TYPE_FLOAT16; break;
+    case tensor::DATA_TYPE_FP32: data_type = DML_TENSOR_DATA_TYPE_FLOAT32; break;
+    case tensor::DATA_TYPE_INT8: data_type = DML_TENSOR_DATA_TYPE_INT8; break;
+    case tensor::DATA_TYPE_UINT4: data_type = DML_TENSOR_DATA_TYPE_UINT4; break;
+    case tensor::DATA_TYPE_INT4: data_type = DML_TENSOR_DATA_TYPE_INT4; break;
+    default:
+        std::cerr << "DirectML has no " << tensor::to_string(desc.data_type) << " tensors." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    dml::TensorDesc::Dimensions sizes(dml_rank, 1);
+    dml::TensorDesc::Dimensions strides(dml_rank, static_cast<std::uint32_t>(desc.get_elements_count()));
+    const std::uint32_t padding = dml_rank - desc.rank;
+    for (std::uint32_t i = 0; i < desc.rank; i++)
+    {
+        sizes[padding + i] = static_cast<std::uint32_t>(desc.shape[i]);
+        strides[padding + i] = static_cast<std::uint32_t>(desc.strides[i]);
+    }
+    // DML buffer sizes are a multiple of 4 bytes
+    const std::uint64_t size = (desc.get_size_in_bytes() + 3) / 4 * 4;
+    return dml::TensorDesc(data_type, DML_TENSOR_FLAG_NONE, sizes, strides, size, 0);
+}
+
 void dx12::Dx12Context::resource_copy(ID3D12Resource* dst, ID3D12Resource* src)
 {
     command_list_->CopyResource(dst, src);
@@ -232,3 +263,5 @@ void dx12::Dx12Context::record_dispatch(IDMLDispatchable* dispatchable, IDMLBind
 {
     dml_cmd_recorder_->RecordDispatch(command_list_.Get(), dispatchable, binding_table);
 }
+
+#endif // #if BUILD_DX12
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <cstdint>
 #include <cstdlib>
 
+#if BUILD_DX12
+#include "tensor.h"
 
 #include <dxgi1_6.h>
 #include <wrl/client.h>
@@ -16,6 +18,9 @@ using Microsoft::WRL::ComPtr;
 
 namespace dx12
 {
+// DirectML buffer tensor of the same data type, shape and strides, padded to 4D with leading ones.
+dml::TensorDesc to_dml_tensor_desc(const tensor::desc_t& desc);
+
 class Dx12Context
 {
 public:
@@ -50,4 +55,6 @@ private:
     ComPtr<IDMLDevice> dml_device_;
     ComPtr<IDMLCommandRecorder> dml_cmd_recorder_;
 };
-}
\ No newline at end of file
+}
+
+#endif // #if BUILD_DX12
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "epilogue.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* epilogue::to_string(ACTIVATION activation)
+{
+    switch (activation)
+    {
+    case ACTIVATION_NONE: return "none";
+    case ACTIVATION_GELU: return "gelu";
+    case ACTIVATION_SILU: return "silu";
+    default: return "unknown";
+    }
+}
+
+bool epilogue::from_string(std::string_view str, ACTIVATION& activation)
+{
+    for (int i = 0; i < ACTIVATION_COUNT; i++)
+    {
+        if (str == to_string(static_cast<ACTIVATION>(i)))
+        {
+            activation = static_cast<ACTIVATION>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string epilogue::to_string(const desc_t& desc)
+{
+    std::string ret{};
+    const auto append = [&](const char* post_op)
+    {
+        ret += ret.empty() ? "" : "+";
+        ret += post_op;
+    };
+    if (desc.bias)
+    {
+        append("bias");
+    }
+    if (desc.activation != ACTIVATION_NONE)
+    {
+        append(to_string(desc.activation));
+    }
+    if (desc.residual)
+    {
+        append("residual");
+    }
+    if (desc.requantize)
+    {
+        append("int8");
+    }
+    return ret.empty() ? "none" : ret;
+}
+
+float epilogue::activate(ACTIVATION activation, float x)
+{
+    switch (activation)
+    {
+    case ACTIVATION_GELU: return 0.5f * x * (1.0f + std::tanh(0.7978845608f * (x + 0.044715f * x * x * x)));
+    case ACTIVATION_SILU: return x / (1.0f + std::exp(-x));
+    default: return x;
+    }
+}
+
+std::int8_t epilogue::requantize(float x, float output_scale)
+{
+    const float q = std::nearbyint(x * (1.0f / output_scale));
+    return static_cast<std::int8_t>(std::clamp(q, -128.0f, 127.0f));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "tensor.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace epilogue
+{
+enum ACTIVATION
+{
+    ACTIVATION_NONE,
+    ACTIVATION_GELU,    // tanh approximation: 0.5 * x * (1 + tanh(sqrt(2 / pi) * (x + 0.044715 * x^3)))
+    ACTIVATION_SILU,    // x * sigmoid(x)
+    // ..
+    ACTIVATION_COUNT
+};
+
+const char* to_string(ACTIVATION activation);
+// "none", "gelu" or "silu"
+bool from_string(std::string_view str, ACTIVATION& activation);
+
+// Post-ops of a GEMM fused into the store of its output tile, applied in this order:
+//   OUT = requantize(activation(A x B + bias) + residual)
+struct desc_t
+{
+    bool bias = false;                          // bias[N] (fp16) added to every row
+    ACTIVATION activation = ACTIVATION_NONE;
+    bool residual = false;                      // residual[M, N] (fp16) added after the activation
+    bool requantize = false;                    // OUT is int8 with a per tensor output_scale, fp16 otherwise
+    float output_scale = 1.0f;
+};
+
+// "none" or the enabled post-ops joined by '+', e.g. "bias+gelu+residual+int8"
+std::string to_string(const desc_t& desc);
+
+inline tensor::DATA_TYPE get_output_data_type(const desc_t& desc)
+{
+    return desc.requantize ? tensor::DATA_TYPE_INT8 : tensor::DATA_TYPE_FP16;
+}
+
+// Scalar definitions shared by the host golden model and the CPU kernels' reduction path.
+float activate(ACTIVATION activation, float x);
+// saturate(round_to_nearest_even(x * (1 / output_scale))), the kernels multiply by the same reciprocal
+std::int8_t requantize(float x, float output_scale);
+}
@@ -0,0 +1,256 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+// Header-only IEEE half precision for host code: a storage type, scalar conversions and bulk conversions.
+// Bulk routines pick the widest hardware conversion at runtime (AVX-512F 16 lanes, F16C 8 lanes) and fall back to the scalar code otherwise.
+// Scalar and hardware paths both round to nearest even, so results don't depend on the machine.
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLOAT16_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FLOAT16_TARGET(isa)
+#else
+#define FLOAT16_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace fp16
+{
+struct float16_t
+{
+    std::uint16_t bits = 0;
+};
+static_assert(sizeof(float16_t) == sizeof(std::uint16_t));
+
+// https://gist.github.com/rygorous/2156668
+inline float to_float(float16_t h)
+{
+    constexpr std::uint32_t shifted_exp = 0x7c00u << 13;
+    const float magic = std::bit_cast<float>(113u << 23);
+
+    std::uint32_t o = (h.bits & 0x7fffu) << 13;
+    const std::uint32_t exp = shifted_exp & o;
+    o += (127u - 15u) << 23;
+    if (exp == shifted_exp)
+    {
+        o += (128u - 16u) << 23;  // Inf/NaN
+    }
+    else if (exp == 0)
+    {
+        o += 1u << 23;  // zero/denormal
+        o = std::bit_cast<std::uint32_t>(std::bit_cast<float>(o) - magic);
+    }
+    o |= (h.bits & 0x8000u) << 16;
+    return std::bit_cast<float>(o);
+}
+
+inline float16_t from_float(float f)
+{
+    constexpr std::uint32_t f32_infty = 255u << 23;
+    constexpr std::uint32_t f16_max = (127u + 16u) << 23;
+    constexpr std::uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    std::uint32_t u = std::bit_cast<std::uint32_t>(f);
+    const std::uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    std::uint16_t o = 0;
+    if (u >= f16_max)
+    {
+        o = (u > f32_infty) ? 0x7e00 : 0x7c00;
+    }
+    else if (u < (113u << 23))
+    {
+        const float d = std::bit_cast<float>(u) + std::bit_cast<float>(denorm_magic);
+        o = static_cast<std::uint16_t>(std::bit_cast<std::uint32_t>(d) - denorm_magic);
+    }
+    else
+    {
+        const std::uint32_t mant_odd = (u >> 13) & 1u;
+        u += ((15u - 127u) << 23) + 0xfffu;  // rebias exponent and round to nearest even
+        u += mant_odd;
+        o = static_cast<std::uint16_t>(u >> 13);
+    }
+    return float16_t{ static_cast<std::uint16_t>(o | (sign >> 16)) };
+}
+
+namespace detail
+{
+enum CONVERSION_ISA
+{
+    CONVERSION_ISA_SCALAR,
+    CONVERSION_ISA_F16C,
+    CONVERSION_ISA_AVX512,
+};
+
+inline CONVERSION_ISA detect_conversion_isa()
+{
+#if FLOAT16_X86_64
+#if defined(_MSC_VER)
+    int leaf0[4]{};
+    __cpuidex(leaf0, 0, 0);
+    if (leaf0[0] < 7)
+    {
+        return CONVERSION_ISA_SCALAR;
+    }
+    int leaf1[4]{};
+    int leaf7[4]{};
+    __cpuidex(leaf1, 1, 0);
+    __cpuidex(leaf7, 7, 0);
+    const bool osxsave = (leaf1[2] >> 27) & 1;
+    const auto xcr0 = osxsave ? _xgetbv(0) : 0;
+    if ((xcr0 & 0xe6) == 0xe6 && ((leaf7[1] >> 16) & 1))
+    {
+        return CONVERSION_ISA_AVX512;
+    }
+    if ((xcr0 & 0x6) == 0x6 && ((leaf1[2] >> 28) & 1) && ((leaf1[2] >> 29) & 1))
+    {
+        return CONVERSION_ISA_F16C;
+    }
+#else
+    // also checks that the OS saves the wider register state
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return CONVERSION_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c"))
+    {
+        return CONVERSION_ISA_F16C;
+    }
+#endif
+#endif
+    return CONVERSION_ISA_SCALAR;
+}
+
+inline CONVERSION_ISA conversion_isa()
+{
+    static const CONVERSION_ISA isa = detect_conversion_isa();
+    return isa;
+}
+
+#if FLOAT16_X86_64
+FLOAT16_TARGET("avx512f")
+inline void to_float_avx512(const float16_t* src, float* dst, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i))));
+    }
+    for (; i < count; i++)
+    {
+        dst[i] = to_float(src[i]);
+    }
+}
+
+FLOAT16_TARGET("avx512f")
+inline void from_float_avx512(const float* src, float16_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+    for (; i < count; i++)
+    {
+        dst[i] = from_float(src[i]);
+    }
+}
+
+FLOAT16_TARGET("avx,f16c")
+inline void to_float_f16c(const float16_t* src, float* dst, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+    for (; i < count; i++)
+    {
+        dst[i] = to_float(src[i]);
+    }
+}
+
+FLOAT16_TARGET("avx,f16c")
+inline void from_float_f16c(const float* src, float16_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+    for (; i < count; i++)
+    {
+        dst[i] = from_float(src[i]);
+    }
+}
+#endif  // #if FLOAT16_X86_64
+}
+
+inline void to_float(const float16_t* src, float* dst, std::size_t count)
+{
+#if FLOAT16_X86_64
+    switch (detail::conversion_isa())
+    {
+    case detail::CONVERSION_ISA_AVX512: detail::to_float_avx512(src, dst, count); return;
+    case detail::CONVERSION_ISA_F16C: detail::to_float_f16c(src, dst, count); return;
+    default: break;
+    }
+#endif
+    for (std::size_t i = 0; i < count; i++)
+    {
+        dst[i] = to_float(src[i]);
+    }
+}
+
+inline void from_float(const float* src, float16_t* dst, std::size_t count)
+{
+#if FLOAT16_X86_64
+    switch (detail::conversion_isa())
+    {
+    case detail::CONVERSION_ISA_AVX512: detail::from_float_avx512(src, dst, count); return;
+    case detail::CONVERSION_ISA_F16C: detail::from_float_f16c(src, dst, count); return;
+    default: break;
+    }
+#endif
+    for (std::size_t i = 0; i < count; i++)
+    {
+        dst[i] = from_float(src[i]);
+    }
+}
+
+inline void to_float(std::span<const float16_t> src, std::span<float> dst)
+{
+    to_float(src.data(), dst.data(), src.size() < dst.size() ? src.size() : dst.size());
+}
+
+inline void from_float(std::span<const float> src, std::span<float16_t> dst)
+{
+    from_float(src.data(), dst.data(), src.size() < dst.size() ? src.size() : dst.size());
+}
+
+inline void fill(std::span<float16_t> dst, float value)
+{
+    const float16_t h = from_float(value);
+    for (auto& element : dst)
+    {
+        element = h;
+    }
+}
+
+// fp16 tensors are carried around as raw bytes
+inline std::span<float16_t> as_float16(std::span<std::byte> bytes)
+{
+    return { reinterpret_cast<float16_t*>(bytes.data()), bytes.size() / sizeof(float16_t) };
+}
+
+inline std::span<const float16_t> as_float16(std::span<const std::byte> bytes)
+{
+    return { reinterpret_cast<const float16_t*>(bytes.data()), bytes.size() / sizeof(float16_t) };
+}
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <cstdint>
+#include <filesystem>
+#include <span>
 #include <vector>
 
 namespace dx12
@@ -12,6 +14,11 @@ namespace cuda
 class CudaContext;
 }
 
+namespace cpu
+{
+class CpuContext;
+}
+
 namespace op
 {
 class IOperator
@@ -28,11 +35,64 @@ public:
         std::size_t iters = 1;
     };
 
+    struct execute_cpu_config_t
+    {
+        std::size_t iters = 1;
+        // cache of the prepacked weights: mapped by prepare() when it matches the operator's weights, written after packing otherwise.
+        // A prepare() with another path than the previous one prepares the weights again.
+        std::filesystem::path packed_weights_path{};
+        // rows of the calls the execution choices are tuned for, the stacked rows of all requests of a batched call, 0 = the operator's M
+        std::uint32_t rows = 0;
+    };
+
+    struct execute_reference_config_t
+    {
+        bool fp64_accumulation = false;
+    };
+
+    // An element matches when it is within any of the tolerances. Defaults allow for different accumulation orders and precisions between backends.
+    struct compare_config_t
+    {
+        float abs_tolerance = 1e-3f;
+        float rel_tolerance = 1e-2f;
+        std::uint32_t ulp_tolerance = 0;
+        std::size_t max_reported_mismatches = 10;
+        cpu::CpuContext* cpu_ctx = nullptr;     // runs the comparison, nullptr uses a temporary context
+    };
+
 public:
+    virtual ~IOperator() = default;
+
+    // prepare() does the one-time work (compilation, resident weights, packing) and is cached by the operator,
+    // run() only binds the current activations and dispatches.
+    // execute() is prepare() followed by config.iters runs, returns the result of the last one.
+    // DirectML and CPU entry points only exist when their backend is built (BUILD_DX12, BUILD_CPU).
+    // The span overloads write the result to the caller's buffer (at least get_output_size() bytes, ex. the next layer's input)
+    // instead of allocating a vector on every call.
+#if BUILD_DX12
+    virtual void prepare(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config) = 0;
+    virtual std::vector<std::byte> run(dx12::Dx12Context* dx_ctx) = 0;
+    virtual void run(dx12::Dx12Context* dx_ctx, std::span<std::byte> out) = 0;
     virtual std::vector<std::byte> execute(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config) = 0;
+    virtual void execute(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config, std::span<std::byte> out) = 0;
+#endif
+#if BUILD_CPU
+    virtual void prepare(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config) = 0;
+    virtual std::vector<std::byte> run(cpu::CpuContext* cpu_ctx) = 0;
+    virtual void run(cpu::CpuContext* cpu_ctx, std::span<std::byte> out) = 0;
+    virtual std::vector<std::byte> execute(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config) = 0;
+    virtual void execute(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config, std::span<std::byte> out) = 0;
+#endif
     virtual std::vector<std::byte> execute(cuda::CudaContext* cu_ctx, const execute_cuda_config_t& config) = 0;
+    virtual void execute(cuda::CudaContext* cu_ctx, const execute_cuda_config_t& config, std::span<std::byte> out) = 0;
+
+    virtual std::size_t get_output_size() const = 0;
+
+    // Host golden model, built with every backend configuration. Deterministic: the result doesn't depend on the thread count.
+    virtual std::vector<std::byte> execute_reference(cpu::CpuContext* cpu_ctx, const execute_reference_config_t& config) = 0;
 
-    virtual bool compare(const std::vector<std::byte>& lhs, const std::vector<std::byte>& rhs) = 0;
+    // lhs is checked against the reference rhs, prints the error statistics and the first mismatches
+    virtual bool compare(const std::vector<std::byte>& lhs, const std::vector<std::byte>& rhs, const compare_config_t& config) = 0;
 };
 
 }
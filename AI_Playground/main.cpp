@@ -1,36 +1,60 @@
 #include "ioperator.h"
 
 #include <iostream>
-#include <sys/stat.h>
-#include <format>
 #include <vector>
-#include <array>
 #include <memory>
-
+#include <span>
 
 #include "quantized_gemm.h"
 
 #include "dx12_context.h"
 #include "cuda_context.h"
+#include "cpu_context.h"
+#include "app_options.h"
 
-struct app_opts_t
-{
-    std::size_t execute_loop = 1;
-};
-
-int main()
+int main(int argc, char* argv[])
 {
     std::cout << "[AI_Playground] starting." << std::endl;
     app_opts_t opts{};
+    if (!parse_args(argc, argv, opts))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // runs the tensor initialization, the host golden model and the comparisons
+    cpu::CpuContext cpu_ctx{ opts.sweep.cpu };
+    opts.compare.cpu_ctx = &cpu_ctx;
 
-    std::unique_ptr<op::IOperator> op{};
     std::cout << "[AI_Playground] Creating quantized GEMM." << std::endl;
     op::QuantizedGemm::create_params_t cp{};
-    cp.K = 512;
-    cp.M = 512;
-    cp.N = 512;
-    cp.block_size = 32;
-    op = std::make_unique<op::QuantizedGemm>(cp);
+    cp.K = opts.sweep.K.front();
+    cp.M = opts.sweep.M.front();
+    cp.N = opts.sweep.N.front();
+    cp.block_size = opts.sweep.block_size.front();
+    cp.b_transposed = opts.sweep.b_transposed;
+    cp.quantization = opts.sweep.quantization.front();
+    cp.dynamic_quantization = opts.sweep.dynamic_quantization.front();
+    cp.epilogue = opts.sweep.epilogue;
+    cp.init = opts.sweep.init;
+    cp.cpu_ctx = &cpu_ctx;
+#if BUILD_CPU
+    cp.cpu_tuning_cache_path = opts.sweep.cpu_tuning_cache_path;
+    cp.cpu_autotune = opts.sweep.cpu_autotune;
+#endif
+    auto gemm = std::make_unique<op::QuantizedGemm>(cp);
+#if BUILD_CPU
+    op::QuantizedGemm* quantized_gemm = gemm.get();     // the batched calls aren't part of IOperator
+    if (!gemm->is_cpu_tuned())
+    {
+        gemm->set_cpu_config(opts.sweep.cpu_gemm);
+    }
+#endif
+    if (!opts.save_weights_path.empty() && !gemm->save_weights(opts.save_weights_path))
+    {
+        return 1;
+    }
+    std::unique_ptr<op::IOperator> op = std::move(gemm);
 
     std::vector<std::byte> result{};
 #if BUILD_CUDA
@@ -41,19 +65,67 @@ int main()
         result = op->execute(&cuda_ctx, op::IOperator::execute_cuda_config_t{ opts.execute_loop });
     }
 #endif  // #if BUILD_CUDA
-    dx12::Dx12Context dx12_ctx{};
+
+#if BUILD_DX12
     if (result.empty())
     {
         std::cout << "[AI_Playground] Executing DML." << std::endl;
+        dx12::Dx12Context dx12_ctx{};
         result = op->execute(&dx12_ctx, op::IOperator::execute_dml_config_t{ opts.execute_loop, false });
     }
+#endif  // #if BUILD_DX12
+
+    std::cout << "[AI_Playground] Executing host golden model to capture reference data." << std::endl;
+    const auto result_reference = op->execute_reference(&cpu_ctx, op::IOperator::execute_reference_config_t{ opts.reference_fp64 });
 
-    std::cout << "[AI_Playground] Executing DML with MetaCommands disabled to capture reference data." << std::endl;
-    std::vector<std::byte> result_reference = op->execute(&dx12_ctx, op::IOperator::execute_dml_config_t{ opts.execute_loop, true });
-  
-    std::cout << "[AI_Playground] Running conformance check." << std::endl;
-    op->compare(result, result_reference);
+    bool passed = true;
+    if (!result.empty())
+    {
+        std::cout << "[AI_Playground] Running conformance check." << std::endl;
+        passed = op->compare(result, result_reference, opts.compare);
+    }
+
+#if BUILD_CPU
+    if (opts.run_cpu)
+    {
+        std::cout << "[AI_Playground] Executing CPU." << std::endl;
+        const op::IOperator::execute_cpu_config_t cpu_config{ opts.execute_loop, opts.packed_weights_path };
+        const auto result_cpu = op->execute(&cpu_ctx, cpu_config);
+        std::cout << "[AI_Playground] Running CPU conformance check." << std::endl;
+        passed = op->compare(result_cpu, result_reference, opts.compare) && passed;
+
+        // continuous batching: A split into requests of consecutive rows, their outputs stacked back are checked like a single call
+        const std::uint32_t batch = opts.sweep.cpu_batch;
+        if (batch > 1 && cp.epilogue.residual)
+        {
+            std::cout << "[AI_Playground] Skipping the CPU batch, requests add the first rows of the residual and A's rows can't be split." << std::endl;
+        }
+        else if (batch > 1)
+        {
+            std::cout << "[AI_Playground] Executing CPU batch of " << batch << " requests." << std::endl;
+            const auto a = quantized_gemm->get_activations();
+            const std::size_t a_row_bytes = a.size() / cp.M;
+            std::vector<std::byte> result_batch(op->get_output_size());
+            const std::size_t out_row_bytes = result_batch.size() / cp.M;
+            std::vector<std::span<const std::byte>> activations{};
+            std::vector<std::span<std::byte>> outputs{};
+            for (std::uint32_t i = 0; i < batch; i++)
+            {
+                const std::size_t begin = std::size_t(i) * cp.M / batch;
+                const std::size_t end = std::size_t(i + 1) * cp.M / batch;
+                if (begin != end)
+                {
+                    activations.push_back(a.subspan(begin * a_row_bytes, (end - begin) * a_row_bytes));
+                    outputs.push_back(std::span(result_batch).subspan(begin * out_row_bytes, (end - begin) * out_row_bytes));
+                }
+            }
+            quantized_gemm->run_batched(&cpu_ctx, activations, outputs);
+            std::cout << "[AI_Playground] Running CPU batch conformance check." << std::endl;
+            passed = op->compare(result_batch, result_reference, opts.compare) && passed;
+        }
+    }
+#endif  // #if BUILD_CPU
 
     std::cout << "[AI_Playground] Finished." << std::endl;
-    return 0;
-}
\ No newline at end of file
+    return passed ? 0 : 1;
+}
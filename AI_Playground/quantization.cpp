@@ -0,0 +1,125 @@
+#include "quantization.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// https://arxiv.org/abs/2305.14314, quantiles of N(0, 1) normalized to [-1, 1] with an exact zero
+constexpr float NF4_TABLE[16] =
+{
+    -1.0f, -0.6961928009986877f, -0.5250730514526367f, -0.39491748809814453f,
+    -0.28444138169288635f, -0.18477343022823334f, -0.09105003625154495f, 0.0f,
+    0.07958029955625534f, 0.16093020141124725f, 0.24611230194568634f, 0.33791524171829224f,
+    0.44070982933044434f, 0.5626170039176941f, 0.7229568362236023f, 1.0f,
+};
+
+// E2M1: 1 sign, 2 exponent and 1 mantissa bits, no infinities or NaNs
+constexpr float FP4_TABLE[16] =
+{
+    0.0f, 0.5f, 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f,
+    -0.0f, -0.5f, -1.0f, -1.5f, -2.0f, -3.0f, -4.0f, -6.0f,
+};
+}
+
+const char* quant::to_string(SCHEME scheme)
+{
+    switch (scheme)
+    {
+    case SCHEME_UINT4_ASYMMETRIC: return "uint4";
+    case SCHEME_INT4_SYMMETRIC: return "int4";
+    case SCHEME_INT8_PER_CHANNEL: return "int8";
+    case SCHEME_NF4: return "nf4";
+    case SCHEME_FP4: return "fp4";
+    default: return "unknown";
+    }
+}
+
+bool quant::from_string(std::string_view str, SCHEME& scheme)
+{
+    for (int i = 0; i < SCHEME_COUNT; i++)
+    {
+        if (str == to_string(static_cast<SCHEME>(i)))
+        {
+            scheme = static_cast<SCHEME>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+tensor::DATA_TYPE quant::get_weights_data_type(SCHEME scheme)
+{
+    switch (scheme)
+    {
+    case SCHEME_INT4_SYMMETRIC: return tensor::DATA_TYPE_INT4;
+    case SCHEME_INT8_PER_CHANNEL: return tensor::DATA_TYPE_INT8;
+    default: return tensor::DATA_TYPE_UINT4;
+    }
+}
+
+bool quant::has_zero_point(SCHEME scheme)
+{
+    return scheme == SCHEME_UINT4_ASYMMETRIC;
+}
+
+bool quant::is_per_channel(SCHEME scheme)
+{
+    return scheme == SCHEME_INT8_PER_CHANNEL;
+}
+
+const float* quant::get_lookup_table(SCHEME scheme)
+{
+    switch (scheme)
+    {
+    case SCHEME_NF4: return NF4_TABLE;
+    case SCHEME_FP4: return FP4_TABLE;
+    default: return nullptr;
+    }
+}
+
+const char* quant::to_string(DYNAMIC_QUANTIZATION dynamic_quantization)
+{
+    switch (dynamic_quantization)
+    {
+    case DYNAMIC_QUANTIZATION_NONE: return "none";
+    case DYNAMIC_QUANTIZATION_INT8_PER_ROW: return "row";
+    case DYNAMIC_QUANTIZATION_INT8_PER_BLOCK: return "block";
+    default: return "unknown";
+    }
+}
+
+bool quant::from_string(std::string_view str, DYNAMIC_QUANTIZATION& dynamic_quantization)
+{
+    for (int i = 0; i < DYNAMIC_QUANTIZATION_COUNT; i++)
+    {
+        if (str == to_string(static_cast<DYNAMIC_QUANTIZATION>(i)))
+        {
+            dynamic_quantization = static_cast<DYNAMIC_QUANTIZATION>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool quant::supports_dynamic_quantization(SCHEME scheme, std::uint32_t K, std::uint32_t block_size)
+{
+    const std::uint32_t quantization_block_size = get_block_size(scheme, K, block_size);
+    return get_lookup_table(scheme) == nullptr && quantization_block_size != 0 && quantization_block_size % 4 == 0;
+}
+
+float quant::quantize_int8(const float* values, std::size_t count, std::int8_t* q)
+{
+    float absmax = 0.0f;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        absmax = std::max(absmax, std::fabs(values[i]));
+    }
+    const float scale = absmax > 0.0f ? absmax / 127.0f : 1.0f;
+    const float inv_scale = absmax > 0.0f ? 127.0f / absmax : 1.0f;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        q[i] = static_cast<std::int8_t>(std::clamp(std::nearbyint(values[i] * inv_scale), -127.0f, 127.0f));
+    }
+    return scale;
+}
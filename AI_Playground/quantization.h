@@ -0,0 +1,61 @@
+#pragma once
+#include "tensor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace quant
+{
+// How B and its quantization params encode the weights. Blockwise schemes quantize blocks of block_size consecutive elements along K,
+// per channel schemes have one scale per column of OUT (a single block spanning K).
+enum SCHEME
+{
+    SCHEME_UINT4_ASYMMETRIC,    // uint4 q, blockwise fp16 scale and uint4 zero point: scale * (q - zero_point)
+    SCHEME_INT4_SYMMETRIC,      // int4 q, blockwise fp16 scale: scale * q
+    SCHEME_INT8_PER_CHANNEL,    // int8 q, fp16 scale per channel: scale * q
+    SCHEME_NF4,                 // uint4 codes of NormalFloat4 (QLoRA), blockwise fp16 absmax scale: scale * NF4[q]
+    SCHEME_FP4,                 // uint4 codes of E2M1 floats (sign in bit 3), blockwise fp16 scale: scale * FP4[q]
+    // ..
+    SCHEME_COUNT
+};
+
+const char* to_string(SCHEME scheme);
+// "uint4", "int4", "int8", "nf4" or "fp4"
+bool from_string(std::string_view str, SCHEME& scheme);
+
+tensor::DATA_TYPE get_weights_data_type(SCHEME scheme);
+bool has_zero_point(SCHEME scheme);
+bool is_per_channel(SCHEME scheme);
+
+// Dequantized values of the 16 codes of lookup table schemes (before scaling), nullptr for the others.
+const float* get_lookup_table(SCHEME scheme);
+
+// Elements of B along K sharing a scale (and zero point): block_size for blockwise schemes, K for per channel ones.
+inline std::uint32_t get_block_size(SCHEME scheme, std::uint32_t K, std::uint32_t block_size)
+{
+    return is_per_channel(scheme) ? K : block_size;
+}
+
+// A quantized on the fly to symmetric int8, so the GEMM runs on integer dot products against the integer B (W4A8 / W8A8).
+// Every row of A (or every quantization block of a row, see get_block_size()) gets its own scale.
+enum DYNAMIC_QUANTIZATION
+{
+    DYNAMIC_QUANTIZATION_NONE,              // A stays fp16
+    DYNAMIC_QUANTIZATION_INT8_PER_ROW,
+    DYNAMIC_QUANTIZATION_INT8_PER_BLOCK,
+    // ..
+    DYNAMIC_QUANTIZATION_COUNT
+};
+
+const char* to_string(DYNAMIC_QUANTIZATION dynamic_quantization);
+// "none", "row" or "block"
+bool from_string(std::string_view str, DYNAMIC_QUANTIZATION& dynamic_quantization);
+
+// Integer B (no lookup table) and dot products of 4 consecutive elements of K, so the quantization block has to be a multiple of 4.
+bool supports_dynamic_quantization(SCHEME scheme, std::uint32_t K, std::uint32_t block_size);
+
+// q = round(values * 127 / max|values|) in [-127, 127], returns the scale max|values| / 127 (1 when all values are 0).
+// Shared by the backends and the golden model, so they see the same codes.
+float quantize_int8(const float* values, std::size_t count, std::int8_t* q);
+}
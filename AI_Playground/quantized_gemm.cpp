@@ -1,279 +1,728 @@
 #include "quantized_gemm.h"
 #include "dx12_context.h"
 #include "cuda_context.h"
-
-#include "DirectXMath.h"
-#include "DirectXPackedVector.h"
-using float16 = DirectX::PackedVector::HALF;
-
+#include "cpu_context.h"
+#include "cpu_compare.h"
+#include "cpu_reference_gemm.h"
+#include "cpu_weights_file.h"
+#if BUILD_CPU
+#include "cpu_arena.h"
+#include "cpu_packed_weights_file.h"
+#include "cpu_quantized_gemm.h"
+#include "cpu_quantized_gemm_tuner.h"
+#endif
+
+#include "tensor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
 namespace
 {
-inline void fill_float16(std::span<std::byte> vec, float value)
+// the codes of the scheme's data type with the same probability, int8 without -128 (symmetric range)
+cpu::distribution_t get_default_b_distribution(quant::SCHEME quantization)
 {
-    auto* f16 = reinterpret_cast<float16*>(vec.data());
-    for (auto i = 0; i < vec.size() / sizeof(float16); i++)
+    switch (quant::get_weights_data_type(quantization))
     {
-        f16[i] = DirectX::PackedVector::XMConvertFloatToHalf(value);
+    case tensor::DATA_TYPE_INT4: return { cpu::DISTRIBUTION_UNIFORM, -8.0f, 7.0f };
+    case tensor::DATA_TYPE_INT8: return { cpu::DISTRIBUTION_UNIFORM, -127.0f, 127.0f };
+    default: return { cpu::DISTRIBUTION_UNIFORM, 0.0f, 15.0f };
     }
 }
+}
 
-inline void fill_uint4(std::span<std::byte> vec, std::uint8_t value)
+op::QuantizedGemm::QuantizedGemm(const create_params_t& params)
+    : params_(params)
 {
-    assert(value < (2 ^ 4));
-    // https://stackoverflow.com/questions/44886203/interpret-int8-as-two-int4
-    auto* u8 = reinterpret_cast<std::uint8_t*>(vec.data());
+    const std::uint32_t block_size = quant::get_block_size(params_.quantization, params_.K, params_.block_size);
+    if (params_.M == 0 || params_.K == 0 || params_.N == 0)
+    {
+        std::cerr << "[QuantizedGemm] M: " << params_.M << ", K: " << params_.K << ", N: " << params_.N << ", every dimension has to be at least 1." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    if (block_size == 0 || params_.K % block_size != 0)
+    {
+        std::cerr << "[QuantizedGemm] K: " << params_.K << ", block_size: " << block_size << ", K has to be a multiple of block_size." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    if (params_.dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE && !quant::supports_dynamic_quantization(params_.quantization, params_.K, params_.block_size))
+    {
+        std::cerr << "[QuantizedGemm] " << quant::to_string(params_.quantization) << " with block_size: " << block_size
+            << " has no int8 dynamic quantization, it needs integer weights and a block size multiple of 4." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::unique_ptr<cpu::CpuContext> temporary_ctx{};
+    cpu::CpuContext* cpu_ctx = params_.cpu_ctx;
+    if (!cpu_ctx)
+    {
+        temporary_ctx = std::make_unique<cpu::CpuContext>();
+        cpu_ctx = temporary_ctx.get();
+    }
+    const auto& init = params_.init;
+
+    // one description per tensor, shared by all backends. B and its quantization params are [N, K] and [N, K / block_size] when transposed,
+    // [K, N] and [K / block_size, N] otherwise. Symmetric schemes have no zero point tensor.
+    const std::uint64_t blocks_count = params_.K / block_size;
+    const auto b_data_type = quant::get_weights_data_type(params_.quantization);
+    const bool has_zero_point = quant::has_zero_point(params_.quantization);
+    std::array<tensor::desc_t, RESOURCE_INDEX_COUNT> descs{};
+    descs[RESOURCE_INDEX_A] = tensor::make_desc(tensor::DATA_TYPE_FP16, { params_.M, params_.K });
+    if (params_.b_transposed)
+    {
+        descs[RESOURCE_INDEX_B] = tensor::make_desc(b_data_type, { params_.N, params_.K });
+        descs[RESOURCE_INDEX_B_QUANTIZATION_SCALE] = tensor::make_desc(tensor::DATA_TYPE_FP16, { params_.N, blocks_count });
+        descs[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT] = tensor::make_desc(tensor::DATA_TYPE_UINT4, { params_.N, has_zero_point ? blocks_count : 0 });
+    }
+    else
+    {
+        descs[RESOURCE_INDEX_B] = tensor::make_desc(b_data_type, { params_.K, params_.N });
+        descs[RESOURCE_INDEX_B_QUANTIZATION_SCALE] = tensor::make_desc(tensor::DATA_TYPE_FP16, { blocks_count, params_.N });
+        descs[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT] = tensor::make_desc(tensor::DATA_TYPE_UINT4, { has_zero_point ? blocks_count : 0, params_.N });
+    }
+    // the epilogue inputs are empty when their post-op isn't enabled
+    const auto& epilogue = params_.epilogue;
+    descs[RESOURCE_INDEX_BIAS] = tensor::make_desc(tensor::DATA_TYPE_FP16, { 1, epilogue.bias ? params_.N : 0 });
+    descs[RESOURCE_INDEX_RESIDUAL] = tensor::make_desc(tensor::DATA_TYPE_FP16, { epilogue.residual ? params_.M : 0, params_.N });
+    descs[RESOURCE_INDEX_OUT] = tensor::make_desc(epilogue::get_output_data_type(epilogue), { params_.M, params_.N });
+
+    // A
+    data_host_[RESOURCE_INDEX_A] = tensor::Tensor(descs[RESOURCE_INDEX_A]);
+    cpu::fill_random_fp16(*cpu_ctx, data_host_[RESOURCE_INDEX_A].get_data(), init.a, init.seed * RESOURCE_INDEX_COUNT + RESOURCE_INDEX_A);
+    // epilogue inputs
+    if (epilogue.bias)
+    {
+        data_host_[RESOURCE_INDEX_BIAS] = tensor::Tensor(descs[RESOURCE_INDEX_BIAS]);
+        cpu::fill_random_fp16(*cpu_ctx, data_host_[RESOURCE_INDEX_BIAS].get_data(), init.bias, init.seed * RESOURCE_INDEX_COUNT + RESOURCE_INDEX_BIAS);
+    }
+    if (epilogue.residual)
+    {
+        data_host_[RESOURCE_INDEX_RESIDUAL] = tensor::Tensor(descs[RESOURCE_INDEX_RESIDUAL]);
+        cpu::fill_random_fp16(*cpu_ctx, data_host_[RESOURCE_INDEX_RESIDUAL].get_data(), init.residual, init.seed * RESOURCE_INDEX_COUNT + RESOURCE_INDEX_RESIDUAL);
+    }
+    // OUT
+    data_host_[RESOURCE_INDEX_OUT] = tensor::Tensor(descs[RESOURCE_INDEX_OUT]);
 
-    for (auto i = 0; i < vec.size(); i++)
+    if (!init.weights_path.empty())
     {
-        u8[i] = std::uint8_t(value);
-        u8[i] |= (std::uint8_t(value) << 4);   // Move the high bits to the low bits
+        if (!params_.b_transposed)
+        {
+            std::cerr << "[QuantizedGemm] weights files hold a transposed B, " << init.weights_path << " can't be used with b_transposed == false." << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        cpu::weights_file_view_t weights{};
+        if (!cpu::map_weights_file(init.weights_path, weights_file_, weights))
+        {
+            std::exit(EXIT_FAILURE);
+        }
+        if (weights.header.K != params_.K || weights.header.N != params_.N || weights.header.block_size != block_size
+            || weights.header.quantization != static_cast<std::uint32_t>(params_.quantization))
+        {
+            std::cerr << "[QuantizedGemm] " << init.weights_path << " holds K: " << weights.header.K << ", N: " << weights.header.N
+                << ", block_size: " << weights.header.block_size
+                << ", quantization: " << (weights.header.quantization < quant::SCHEME_COUNT ? quant::to_string(static_cast<quant::SCHEME>(weights.header.quantization)) : "unknown")
+                << ", the operator was created with K: " << params_.K << ", N: " << params_.N << ", block_size: " << block_size
+                << ", quantization: " << quant::to_string(params_.quantization) << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        tensors_[RESOURCE_INDEX_B] = tensor::TensorView(descs[RESOURCE_INDEX_B], weights.b);
+        tensors_[RESOURCE_INDEX_B_QUANTIZATION_SCALE] = tensor::TensorView(descs[RESOURCE_INDEX_B_QUANTIZATION_SCALE], weights.b_scale);
+        tensors_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT] = tensor::TensorView(descs[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT], weights.b_zero_point);
     }
+    else
+    {
+        // B
+        data_host_[RESOURCE_INDEX_B] = tensor::Tensor(descs[RESOURCE_INDEX_B]);
+        const auto b_distribution = init.b.value_or(get_default_b_distribution(params_.quantization));
+        const std::uint64_t b_seed = init.seed * RESOURCE_INDEX_COUNT + RESOURCE_INDEX_B;
+        switch (b_data_type)
+        {
+        case tensor::DATA_TYPE_INT4: cpu::fill_random_int4(*cpu_ctx, data_host_[RESOURCE_INDEX_B].get_data(), b_distribution, b_seed); break;
+        case tensor::DATA_TYPE_INT8: cpu::fill_random_int8(*cpu_ctx, data_host_[RESOURCE_INDEX_B].get_data(), b_distribution, b_seed); break;
+        default: cpu::fill_random_uint4(*cpu_ctx, data_host_[RESOURCE_INDEX_B].get_data(), b_distribution, b_seed); break;
+        }
+        // B quantization params
+        // B scales
+        data_host_[RESOURCE_INDEX_B_QUANTIZATION_SCALE] = tensor::Tensor(descs[RESOURCE_INDEX_B_QUANTIZATION_SCALE]);
+        cpu::fill_random_fp16(*cpu_ctx, data_host_[RESOURCE_INDEX_B_QUANTIZATION_SCALE].get_data(), init.b_scale, init.seed * RESOURCE_INDEX_COUNT + RESOURCE_INDEX_B_QUANTIZATION_SCALE);
+        // B zero points
+        if (has_zero_point)
+        {
+            data_host_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT] = tensor::Tensor(descs[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT]);
+            cpu::fill_random_uint4(*cpu_ctx, data_host_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT].get_data(), init.b_zero_point, init.seed * RESOURCE_INDEX_COUNT + RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT);
+        }
+    }
+
+    for (auto i = 0; i < RESOURCE_INDEX_COUNT; i++)
+    {
+        // the zero point of symmetric schemes and disabled epilogue inputs are empty views of their description
+        if (tensors_[i].empty())
+        {
+            tensors_[i] = data_host_[i].empty() ? tensor::TensorView(descs[i], {}) : data_host_[i].get_view();
+        }
+    }
+
+#if BUILD_CPU
+    if (!params_.cpu_tuning_cache_path.empty() && std::filesystem::exists(params_.cpu_tuning_cache_path)
+        && cpu_tuning_cache_.load(params_.cpu_tuning_cache_path))
+    {
+        const auto key = cpu::make_tuning_key(*cpu_ctx, get_cpu_desc());
+        if (const auto* config = cpu_tuning_cache_.find(key))
+        {
+            cpu_config_ = *config;
+            cpu_tuned_key_ = key;
+        }
+    }
+#endif
 }
 
+bool op::QuantizedGemm::save_weights(const std::filesystem::path& path) const
+{
+    if (!params_.b_transposed)
+    {
+        std::cerr << "[QuantizedGemm] weights files hold a transposed B, can't save a [K, N] B to " << path << "." << std::endl;
+        return false;
+    }
+    return cpu::write_weights_file(path, params_.K, params_.N, quant::get_block_size(params_.quantization, params_.K, params_.block_size), params_.quantization,
+        tensors_[RESOURCE_INDEX_B].get_data(), tensors_[RESOURCE_INDEX_B_QUANTIZATION_SCALE].get_data(), tensors_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT].get_data());
 }
 
-op::QuantizedGemm::QuantizedGemm(const create_params_t& params)
-    : params_(params)
+#if BUILD_DX12
+struct op::QuantizedGemm::dml_prepared_t
 {
-    assert((params_.K / params_.block_size) != 0);
-    assert(params_.b_transposed == true); // not supporting non-b tranposed yet
+    dx12::Dx12Context* ctx = nullptr;
+    execute_dml_config_t config{};
 
-    const float dt_size = sizeof(float16);
-    const float uint4_size = 0.5f;
-    // A
-    data_host_[RESOURCE_INDEX_A].resize(params_.M * params_.K * dt_size);
-    fill_float16(data_host_[RESOURCE_INDEX_A], 1.0f);
-    // B
-    data_host_[RESOURCE_INDEX_B].resize(params_.K * params_.N * uint4_size);
-    fill_uint4(data_host_[RESOURCE_INDEX_B], 1);
-    // OUT
-    data_host_[RESOURCE_INDEX_OUT].resize(params_.M * params_.N * dt_size);
-    
-    // B quantization params
-    // B scales
-    data_host_[RESOURCE_INDEX_B_QUANTIZATION_SCALE].resize(params_.N * (params_.K / params_.block_size) * dt_size);
-    fill_float16(data_host_[RESOURCE_INDEX_B_QUANTIZATION_SCALE], 1.0f);
-    // B zero points
-    data_host_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT].resize(params_.N * (params_.K / params_.block_size) * uint4_size);
-    fill_uint4(data_host_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT], 0);
-}
+    ComPtr<IDMLCompiledOperator> compiled_op;
+    ComPtr<ID3D12DescriptorHeap> descriptor_heap;
+    ComPtr<IDMLBindingTable> binding_table;
+    ComPtr<ID3D12Resource> temporary_buffer;
+    ComPtr<ID3D12Resource> persistent_buffer;
 
-std::vector<std::byte> op::QuantizedGemm::execute(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config)
+    // weights stay resident, only the activations are uploaded again by run()
+    std::array<ComPtr<ID3D12Resource>, RESOURCE_INDEX_COUNT> gpu_resources;
+    std::array<std::size_t, RESOURCE_INDEX_COUNT> upload_offsets{};
+    ComPtr<ID3D12Resource> upload_buffer;
+    ComPtr<ID3D12Resource> readback_buffer;
+};
+
+#endif  // #if BUILD_DX12
+
+#if BUILD_CPU
+struct op::QuantizedGemm::cpu_prepared_t
+{
+    cpu::CpuContext* ctx = nullptr;
+    std::filesystem::path packed_weights_path;  // of the config, empty when the weights were packed in memory only
+    cpu::MappedFile packed_file;    // backs weights.packed when it was loaded from a packed weights file
+    cpu::quantized_gemm_weights_t weights;
+};
+#endif  // #if BUILD_CPU
+
+op::QuantizedGemm::~QuantizedGemm() = default;
+
+#if BUILD_DX12
+void op::QuantizedGemm::prepare(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config)
 {
+    if (dml_prepared_ && dml_prepared_->ctx == dx_ctx && dml_prepared_->config.disable_metacommands == config.disable_metacommands)
+    {
+        return;
+    }
+    auto prepared = std::make_unique<dml_prepared_t>();
+    prepared->ctx = dx_ctx;
+    prepared->config = config;
+
+    assert(quant::get_lookup_table(params_.quantization) == nullptr);
     dml::Graph dml_graph = dx_ctx->create_graph();
-    std::vector<dml::Expression> tensor_b_quantization_params(2);
-    tensor_b_quantization_params[0] = dml::InputTensor(dml_graph, RESOURCE_INDEX_B_QUANTIZATION_SCALE, dml::TensorDesc(DML_TENSOR_DATA_TYPE_FLOAT16, DML_TENSOR_FLAG_NONE, { 1, 1, params_.N, params_.K / params_.block_size })); // transposed!!
-    tensor_b_quantization_params[1] = dml::InputTensor(dml_graph, RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT, dml::TensorDesc(DML_TENSOR_DATA_TYPE_UINT4, DML_TENSOR_FLAG_NONE, { 1, 1, params_.N, params_.K / params_.block_size })); // transposed!!
-    const auto tensor_a = dml::InputTensor(dml_graph, RESOURCE_INDEX_A, dml::TensorDesc(DML_TENSOR_DATA_TYPE_FLOAT16, DML_TENSOR_FLAG_NONE, { 1, 1, params_.M, params_.K }));
-    const auto tensor_b = dml::InputTensor(dml_graph, RESOURCE_INDEX_B, dml::TensorDesc(DML_TENSOR_DATA_TYPE_UINT4, DML_TENSOR_FLAG_NONE, { 1, 1, params_.N, params_.K }));  // transposed!!
-    const auto dequant_input_b = dml::Dequantize(tensor_b, tensor_b_quantization_params, DML_QUANTIZATION_TYPE_SCALE_ZERO_POINT);
+    // empty tensors (the zero point of symmetric schemes, disabled epilogue inputs) aren't bound, the bound ones are numbered in resource order
+    std::array<std::uint32_t, RESOURCE_INDEX_COUNT> input_indices{};
+    std::uint32_t inputs = 0;
+    for (auto i = 0; i < RESOURCE_INDEX_OUT; i++)
+    {
+        input_indices[i] = inputs;
+        inputs += tensors_[i].empty() ? 0 : 1;
+    }
+    const auto input_tensor = [&](RESOURCE_INDEX idx)
+    {
+        return dml::InputTensor(dml_graph, input_indices[idx], dx12::to_dml_tensor_desc(tensors_[idx].get_desc()));
+    };
+
+    // the symmetric schemes dequantize with the scale only
+    const bool has_zero_point = quant::has_zero_point(params_.quantization);
+    std::vector<dml::Expression> tensor_b_quantization_params(has_zero_point ? 2 : 1);
+    tensor_b_quantization_params[0] = input_tensor(RESOURCE_INDEX_B_QUANTIZATION_SCALE); // transposed!!
+    if (has_zero_point)
+    {
+        tensor_b_quantization_params[1] = input_tensor(RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT); // transposed!!
+    }
+    const auto tensor_a = input_tensor(RESOURCE_INDEX_A);
+    const auto tensor_b = input_tensor(RESOURCE_INDEX_B); // transposed!!
+    const auto dequant_input_b = dml::Dequantize(tensor_b, tensor_b_quantization_params,
+        has_zero_point ? DML_QUANTIZATION_TYPE_SCALE_ZERO_POINT : DML_QUANTIZATION_TYPE_SCALE);
+
+    // epilogue as elementwise ops after the GEMM, DML fuses them into its output where it can. The bias is broadcast over M as GEMM's C.
+    // DML's GELU is the exact erf form, within the conformance tolerances of the tanh approximation of the host models.
+    // C and the quantization params of the output need the dimension count of the GEMM's output, the bound tensors are 4D { 1, 1, M, N }.
+    const auto& epilogue = params_.epilogue;
+    const dml::TensorDimensions out_sizes{ 1, 1, params_.M, params_.N };
+    dml::Optional<dml::Expression> tensor_c{};
+    if (epilogue.bias)
+    {
+        tensor_c = dml::Reinterpret(input_tensor(RESOURCE_INDEX_BIAS), out_sizes, dml::TensorStrides{ 0, 0, 0, 1 });
+    }
+    auto result = dml::GemmBuilder(tensor_a, dequant_input_b, tensor_c).Alpha(1.0f).Beta(1.0f).TransB(params_.b_transposed ? DML_MATRIX_TRANSFORM_TRANSPOSE : DML_MATRIX_TRANSFORM_NONE).Build();
+    switch (epilogue.activation)
+    {
+    case epilogue::ACTIVATION_GELU: result = dml::ActivationGelu(result); break;
+    case epilogue::ACTIVATION_SILU: result = result * dml::ActivationSigmoid(result); break;
+    default: break;
+    }
+    if (epilogue.residual)
+    {
+        result = result + input_tensor(RESOURCE_INDEX_RESIDUAL);
+    }
+    if (epilogue.requantize)
+    {
+        // the host models requantize the fp32 result, the scale has the data type of QuantizeLinear's input
+        DML_SCALAR_UNION output_scale{};
+        output_scale.Float32 = epilogue.output_scale;
+        DML_SCALAR_UNION output_zero_point{};
+        output_zero_point.Int8 = 0;
+        result = dml::QuantizeLinear(dml::Cast(result, DML_TENSOR_DATA_TYPE_FLOAT32),
+            dml::FillValueConstant(dml_graph, out_sizes, DML_TENSOR_DATA_TYPE_FLOAT32, output_scale),
+            dml::FillValueConstant(dml_graph, out_sizes, DML_TENSOR_DATA_TYPE_INT8, output_zero_point), DML_TENSOR_DATA_TYPE_INT8);
+    }
     std::vector<dml::Expression> outs(1);
-    outs[0] = dml::GemmBuilder(tensor_a, dequant_input_b/*, tensor_c*/).Alpha(1.0f).Beta(1.0f).TransB(DML_MATRIX_TRANSFORM_TRANSPOSE).Build();
-    
+    outs[0] = result;
+
     auto exec_flags = DML_EXECUTION_FLAG_ALLOW_HALF_PRECISION_COMPUTATION;
     if (config.disable_metacommands)
     {
         exec_flags |= DML_EXECUTION_FLAG_DISABLE_META_COMMANDS;
     }
-    // count inputs
-    std::uint32_t inputs = 0;
-    for (auto i = 0; i < RESOURCE_INDEX_OUT; i++)
-    {
-        if (!data_host_.empty())
-        {
-            inputs++;
-        }
-    }
-    const auto compiled_op = dml_graph.Compile(exec_flags, outs, inputs);
+    prepared->compiled_op = dml_graph.Compile(exec_flags, outs, inputs);
 
-    const auto dml_operator_initializer = dx_ctx->create_initalizer(compiled_op.Get());
+    const auto dml_operator_initializer = dx_ctx->create_initalizer(prepared->compiled_op.Get());
 
     const auto initialize_binding_properties = dml_operator_initializer->GetBindingProperties();
-    const auto execute_binding_properties = compiled_op->GetBindingProperties();
+    const auto execute_binding_properties = prepared->compiled_op->GetBindingProperties();
     const auto descriptor_count = max(
         initialize_binding_properties.RequiredDescriptorCount,
         execute_binding_properties.RequiredDescriptorCount);
 
     // Create descriptor heaps.
-    const auto descriptor_heap = dx_ctx->create_heap(descriptor_count);
-    dx_ctx->set_heap(descriptor_heap.Get());
-
+    prepared->descriptor_heap = dx_ctx->create_heap(descriptor_count);
+    dx_ctx->set_heap(prepared->descriptor_heap.Get());
 
     DML_BINDING_TABLE_DESC dml_binding_table_desc{};
     dml_binding_table_desc.Dispatchable = dml_operator_initializer.Get();
-    dml_binding_table_desc.CPUDescriptorHandle = descriptor_heap->GetCPUDescriptorHandleForHeapStart();
-    dml_binding_table_desc.GPUDescriptorHandle = descriptor_heap->GetGPUDescriptorHandleForHeapStart();
+    dml_binding_table_desc.CPUDescriptorHandle = prepared->descriptor_heap->GetCPUDescriptorHandleForHeapStart();
+    dml_binding_table_desc.GPUDescriptorHandle = prepared->descriptor_heap->GetGPUDescriptorHandleForHeapStart();
     dml_binding_table_desc.SizeInDescriptors = descriptor_count;
-    const auto dml_binding_table = dx_ctx->create_binding_table(dml_binding_table_desc);
+    prepared->binding_table = dx_ctx->create_binding_table(dml_binding_table_desc);
 
     const auto temporary_resource_size = max(
         initialize_binding_properties.TemporaryResourceSize,
         execute_binding_properties.TemporaryResourceSize);
     const auto persistent_resource_size = execute_binding_properties.PersistentResourceSize;
 
-    ComPtr<ID3D12Resource> temporary_buffer{};
     if (temporary_resource_size != 0)
     {
-        temporary_buffer = dx_ctx->create_buffer(temporary_resource_size);
+        prepared->temporary_buffer = dx_ctx->create_buffer(temporary_resource_size);
 
         if (initialize_binding_properties.TemporaryResourceSize != 0)
         {
-            DML_BUFFER_BINDING buffer_binding{ temporary_buffer.Get(), 0, temporary_resource_size };
+            DML_BUFFER_BINDING buffer_binding{ prepared->temporary_buffer.Get(), 0, temporary_resource_size };
             DML_BINDING_DESC binding_desc{ DML_BINDING_TYPE_BUFFER, &buffer_binding };
-            dml_binding_table->BindTemporaryResource(&binding_desc);
+            prepared->binding_table->BindTemporaryResource(&binding_desc);
         }
     }
 
-    ComPtr<ID3D12Resource> persistent_buffer{};
     if (persistent_resource_size != 0)
     {
-        temporary_buffer = dx_ctx->create_buffer(persistent_resource_size);
+        prepared->persistent_buffer = dx_ctx->create_buffer(persistent_resource_size);
 
         // The persistent resource should be bound as the output to the IDMLOperatorInitializer.
-        DML_BUFFER_BINDING buffer_binding{ persistent_buffer.Get(), 0, persistent_resource_size };
+        DML_BUFFER_BINDING buffer_binding{ prepared->persistent_buffer.Get(), 0, persistent_resource_size };
         DML_BINDING_DESC binding_desc{ DML_BINDING_TYPE_BUFFER, &buffer_binding };
-        dml_binding_table->BindOutputs(1, &binding_desc);
+        prepared->binding_table->BindOutputs(1, &binding_desc);
     }
 
-    dx_ctx->record_dispatch(dml_operator_initializer.Get(), dml_binding_table.Get());
+    dx_ctx->record_dispatch(dml_operator_initializer.Get(), prepared->binding_table.Get());
     dx_ctx->synchronize();
 
-    // execute
-    dx_ctx->set_heap(descriptor_heap.Get());
-
-    dml_binding_table_desc.Dispatchable = compiled_op.Get();
-    dml_binding_table_desc.CPUDescriptorHandle = descriptor_heap->GetCPUDescriptorHandleForHeapStart();
-    dml_binding_table_desc.GPUDescriptorHandle = descriptor_heap->GetGPUDescriptorHandleForHeapStart();
-    dml_binding_table_desc.SizeInDescriptors = descriptor_count;
-
-    dml_binding_table->Reset(&dml_binding_table_desc);
+    // bind for execution
+    dml_binding_table_desc.Dispatchable = prepared->compiled_op.Get();
+    prepared->binding_table->Reset(&dml_binding_table_desc);
 
     if (temporary_resource_size != 0)
     {
-        DML_BUFFER_BINDING bufferBinding{ temporary_buffer.Get(), 0, temporary_resource_size };
+        DML_BUFFER_BINDING bufferBinding{ prepared->temporary_buffer.Get(), 0, temporary_resource_size };
         DML_BINDING_DESC bindingDesc{ DML_BINDING_TYPE_BUFFER, &bufferBinding };
-        dml_binding_table->BindTemporaryResource(&bindingDesc);
+        prepared->binding_table->BindTemporaryResource(&bindingDesc);
     }
 
     if (persistent_resource_size != 0)
     {
-        DML_BUFFER_BINDING bufferBinding{ persistent_buffer.Get(), 0, persistent_resource_size };
+        DML_BUFFER_BINDING bufferBinding{ prepared->persistent_buffer.Get(), 0, persistent_resource_size };
         DML_BINDING_DESC bindingDesc{ DML_BINDING_TYPE_BUFFER, &bufferBinding };
-        dml_binding_table->BindPersistentResource(&bindingDesc);
+        prepared->binding_table->BindPersistentResource(&bindingDesc);
     }
 
-
-    auto upload_buffer = dx_ctx->create_upload_buffer([this]() {
-        std::size_t total_tensors_size = 0;
-        for (const auto& dh : data_host_)
-        {
-            total_tensors_size += dh.size();
-        }
-        return total_tensors_size;
-        }());
+    // upload all inputs once, the upload buffer is kept for the activations
+    std::size_t total_tensors_size = 0;
+    for (auto i = 0; i < RESOURCE_INDEX_COUNT; i++)
+    {
+        prepared->upload_offsets[i] = total_tensors_size;
+        total_tensors_size += tensors_[i].get_size_in_bytes();
+    }
+    prepared->upload_buffer = dx_ctx->create_upload_buffer(total_tensors_size);
 
     std::byte* upload_ptr = nullptr;
-    upload_buffer->Map(0, nullptr, reinterpret_cast<void**>(&upload_ptr));
-    for (const auto& dh : data_host_)
+    prepared->upload_buffer->Map(0, nullptr, reinterpret_cast<void**>(&upload_ptr));
+    for (auto i = 0; i < RESOURCE_INDEX_COUNT; i++)
     {
+        const auto dh = tensors_[i].get_data();
         if (dh.empty())
         {
             continue;
         }
-        std::memcpy(upload_ptr, dh.data(), dh.size());
-        upload_ptr += dh.size();
+        std::memcpy(upload_ptr + prepared->upload_offsets[i], dh.data(), dh.size());
     }
-    upload_buffer->Unmap(0, nullptr);
-    dx_ctx->synchronize();
+    prepared->upload_buffer->Unmap(0, nullptr);
 
-    std::array<ComPtr<ID3D12Resource>, RESOURCE_INDEX_COUNT> gpu_resources;
-    std::size_t upload_heap_offset_counter = 0;
-    for (auto i = 0; i < gpu_resources.size(); i++)
+    for (auto i = 0; i < RESOURCE_INDEX_COUNT; i++)
     {
-        const auto& dh = data_host_[i];
+        const auto dh = tensors_[i].get_data();
         if (dh.empty())
         {
             continue;
         }
-        gpu_resources[i] = dx_ctx->create_buffer(dh.size());
-        dx_ctx->copy_buffer_region(dh.size(), gpu_resources[i].Get(), 0, upload_buffer.Get(), upload_heap_offset_counter);
-        upload_heap_offset_counter += dh.size();
+        prepared->gpu_resources[i] = dx_ctx->create_buffer(dh.size());
+        dx_ctx->copy_buffer_region(dh.size(), prepared->gpu_resources[i].Get(), 0, prepared->upload_buffer.Get(), prepared->upload_offsets[i]);
     }
     dx_ctx->synchronize();
+
     std::array<DML_BUFFER_BINDING, RESOURCE_INDEX_COUNT> bindings_buffer;
     for (auto i = 0; i < RESOURCE_INDEX_COUNT; i++)
     {
-        const auto& dh = data_host_[i];
+        const auto dh = tensors_[i].get_data();
         if (dh.empty())
         {
             continue;
         }
-        bindings_buffer[i] = DML_BUFFER_BINDING{ gpu_resources[i].Get(), 0, dh.size() };
+        bindings_buffer[i] = DML_BUFFER_BINDING{ prepared->gpu_resources[i].Get(), 0, dh.size() };
     }
     std::vector<DML_BINDING_DESC> input_binding_desc_list{};
     for (int i = 0; i < RESOURCE_INDEX_OUT; i++)
     {
-        const auto& dh = data_host_[i];
+        const auto dh = tensors_[i].get_data();
         if (dh.empty())
         {
             continue;
         }
         input_binding_desc_list.push_back({ DML_BINDING_TYPE_BUFFER, &bindings_buffer[i] });
     }
-    dml_binding_table->BindInputs(input_binding_desc_list.size(), input_binding_desc_list.data());
+    prepared->binding_table->BindInputs(static_cast<std::uint32_t>(input_binding_desc_list.size()), input_binding_desc_list.data());
 
-    DML_BINDING_DESC output_binding_desc{ DML_BINDING_TYPE_BUFFER, &bindings_buffer[RESOURCE_INDEX_OUT]};
-    dml_binding_table->BindOutputs(1, &output_binding_desc);
+    DML_BINDING_DESC output_binding_desc{ DML_BINDING_TYPE_BUFFER, &bindings_buffer[RESOURCE_INDEX_OUT] };
+    prepared->binding_table->BindOutputs(1, &output_binding_desc);
 
-    dx_ctx->set_heap(descriptor_heap.Get());
-    dx_ctx->record_dispatch(compiled_op.Get(), dml_binding_table.Get());
-    dx_ctx->synchronize();
-    // readback result
+    prepared->readback_buffer = dx_ctx->create_readback_buffer(tensors_[RESOURCE_INDEX_OUT].get_size_in_bytes());
+    dml_prepared_ = std::move(prepared);
+}
 
-    ComPtr<ID3D12Resource> readback_buffer = dx_ctx->create_readback_buffer(data_host_[RESOURCE_INDEX_OUT].size());
-    dx_ctx->resource_state_transition(gpu_resources[RESOURCE_INDEX_OUT].Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
-    dx_ctx->resource_copy(readback_buffer.Get(), gpu_resources[RESOURCE_INDEX_OUT].Get());
+std::vector<std::byte> op::QuantizedGemm::run(dx12::Dx12Context* dx_ctx)
+{
+    std::vector<std::byte> ret(get_output_size());
+    run(dx_ctx, ret);
+    return ret;
+}
+
+void op::QuantizedGemm::run(dx12::Dx12Context* dx_ctx, std::span<std::byte> out)
+{
+    assert(dml_prepared_ && dml_prepared_->ctx == dx_ctx);
+    assert(out.size() >= get_output_size());
+    auto& prepared = *dml_prepared_;
+    const auto activations = tensors_[RESOURCE_INDEX_A].get_data();
+    auto* gpu_activations = prepared.gpu_resources[RESOURCE_INDEX_A].Get();
+    auto* gpu_output = prepared.gpu_resources[RESOURCE_INDEX_OUT].Get();
+
+    std::byte* upload_ptr = nullptr;
+    prepared.upload_buffer->Map(0, nullptr, reinterpret_cast<void**>(&upload_ptr));
+    std::memcpy(upload_ptr + prepared.upload_offsets[RESOURCE_INDEX_A], activations.data(), activations.size());
+    prepared.upload_buffer->Unmap(0, nullptr);
+
+    // single submission: upload activations, dispatch, readback
+    dx_ctx->copy_buffer_region(activations.size(), gpu_activations, 0, prepared.upload_buffer.Get(), prepared.upload_offsets[RESOURCE_INDEX_A]);
+    dx_ctx->resource_state_transition(gpu_activations, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    dx_ctx->set_heap(prepared.descriptor_heap.Get());
+    dx_ctx->record_dispatch(prepared.compiled_op.Get(), prepared.binding_table.Get());
+    dx_ctx->resource_state_transition(gpu_output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    dx_ctx->resource_copy(prepared.readback_buffer.Get(), gpu_output);
     dx_ctx->synchronize();
 
     std::byte* ret_ptr = nullptr;
-    readback_buffer->Map(0, nullptr, reinterpret_cast<void**>(&ret_ptr));
-    std::vector<std::byte> ret(data_host_[RESOURCE_INDEX_OUT].size());
-    std::memcpy(ret.data(), ret_ptr, ret.size());
-    readback_buffer->Unmap(0, nullptr);
-
-    //const auto* ret_f16 = reinterpret_cast<const float16*>(ret.data());
-    //std::vector<float> ret_f32(ret.size() * 2);
-    //DirectX::PackedVector::XMConvertHalfToFloatStream(ret_f32.data(), sizeof(float), ret_f16, sizeof(float16), ret.size() / 2);
+    prepared.readback_buffer->Map(0, nullptr, reinterpret_cast<void**>(&ret_ptr));
+    std::memcpy(out.data(), ret_ptr, get_output_size());
+    prepared.readback_buffer->Unmap(0, nullptr);
+}
+
+std::vector<std::byte> op::QuantizedGemm::execute(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config)
+{
+    // DML dequantizes integers only, an empty result skips the conformance check of the lookup table schemes
+    if (quant::get_lookup_table(params_.quantization) != nullptr)
+    {
+        std::cout << "[QuantizedGemm] DML has no " << quant::to_string(params_.quantization) << " dequantization, skipping." << std::endl;
+        return std::vector<std::byte>();
+    }
+    if (params_.dynamic_quantization != quant::DYNAMIC_QUANTIZATION_NONE)
+    {
+        std::cout << "[QuantizedGemm] DML runs fp16 activations only, skipping " << quant::to_string(params_.dynamic_quantization) << " dynamic quantization." << std::endl;
+        return std::vector<std::byte>();
+    }
+    std::vector<std::byte> ret(get_output_size());
+    execute(dx_ctx, config, ret);
     return ret;
 }
 
+void op::QuantizedGemm::execute(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config, std::span<std::byte> out)
+{
+    prepare(dx_ctx, config);
+    for (std::size_t i = 0; i < config.iters; i++)
+    {
+        run(dx_ctx, out);
+    }
+}
+
+#endif  // #if BUILD_DX12
+
 std::vector<std::byte> op::QuantizedGemm::execute(cuda::CudaContext* cu_ctx, const execute_cuda_config_t& config)
+{
+    // the CUDA path doesn't compute anything yet, an empty result skips its conformance check
+    execute(cu_ctx, config, std::span<std::byte>());
+    return std::vector<std::byte>();
+}
+
+void op::QuantizedGemm::execute([[maybe_unused]] cuda::CudaContext* cu_ctx, [[maybe_unused]] const execute_cuda_config_t& config, [[maybe_unused]] std::span<std::byte> out)
 {
 #if BUILD_CUDA
     cu_ctx->create_kernel(std::filesystem::path("C:\\WORK\\AI_Playground\\AI_Playground\\kernels\\vec_add.ptx"), "_Z7vec_addPfS_S_");
 #endif // #if BUILD_CUDA
-    return std::vector<std::byte>();
 }
 
-bool op::QuantizedGemm::compare(const std::vector<std::byte>& lhs, const std::vector<std::byte>& rhs)
+#if BUILD_CPU
+cpu::quantized_gemm_desc_t op::QuantizedGemm::get_cpu_desc() const
 {
-    assert(lhs.size() == rhs.size());
-    const float16* data_f16 = reinterpret_cast<const float16*>(lhs.data());
-    const float16* data_f16_ref = reinterpret_cast<const float16*>(rhs.data());
-    for (int i = 0; i < lhs.size() / sizeof(float16); i++)
+    return cpu::quantized_gemm_desc_t{ params_.M, params_.K, params_.N, params_.block_size, params_.b_transposed, params_.quantization,
+        params_.dynamic_quantization };
+}
+
+std::unique_ptr<op::QuantizedGemm::cpu_prepared_t> op::QuantizedGemm::prepare_cpu_weights(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config) const
+{
+    const auto desc = get_cpu_desc();
+    auto prepared = std::make_unique<cpu_prepared_t>();
+    prepared->ctx = cpu_ctx;
+    prepared->packed_weights_path = config.packed_weights_path;
+    if (config.packed_weights_path.empty())
+    {
+        prepared->weights = cpu::prepare_quantized_gemm_weights(*cpu_ctx, desc,
+            tensors_[RESOURCE_INDEX_B].get_data(), tensors_[RESOURCE_INDEX_B_QUANTIZATION_SCALE].get_data(), tensors_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT].get_data());
+    }
+    else
+    {
+        // the packed file is a cache of the current weights: it's used when it was packed from them, rebuilt otherwise
+        std::uint64_t source_checksum = cpu::checksum(*cpu_ctx, tensors_[RESOURCE_INDEX_B].get_data());
+        source_checksum = cpu::checksum(*cpu_ctx, tensors_[RESOURCE_INDEX_B_QUANTIZATION_SCALE].get_data(), source_checksum);
+        source_checksum = cpu::checksum(*cpu_ctx, tensors_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT].get_data(), source_checksum);
+        if (!std::filesystem::exists(config.packed_weights_path)
+            || !cpu::map_packed_weights_file(*cpu_ctx, config.packed_weights_path, desc, source_checksum, prepared->packed_file, prepared->weights))
+        {
+            std::cout << "[QuantizedGemm] Packing weights to " << config.packed_weights_path << std::endl;
+            prepared->packed_file.close();
+            prepared->weights = cpu::prepare_quantized_gemm_weights(*cpu_ctx, desc,
+                tensors_[RESOURCE_INDEX_B].get_data(), tensors_[RESOURCE_INDEX_B_QUANTIZATION_SCALE].get_data(), tensors_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT].get_data());
+            cpu::write_packed_weights_file(*cpu_ctx, config.packed_weights_path, prepared->weights, source_checksum);
+        }
+    }
+    return prepared;
+}
+
+void op::QuantizedGemm::prepare(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config)
+{
+    // another packed weights file is mapped (or written) again, the weights were packed from the same tensors either way
+    if (!cpu_prepared_ || cpu_prepared_->ctx != cpu_ctx || cpu_prepared_->packed_weights_path != config.packed_weights_path)
+    {
+        cpu_prepared_ = prepare_cpu_weights(cpu_ctx, config);
+    }
+
+    // The context may not be the one the operator was created with and the calls may not run its M rows (batches stack their requests),
+    // a config tuned for other threads, another ISA or another row count doesn't carry over.
+    auto desc = get_cpu_desc();
+    desc.M = config.rows != 0 ? config.rows : params_.M;
+    const auto key = cpu::make_tuning_key(*cpu_ctx, desc);
+    if (cpu_tuned_key_ && *cpu_tuned_key_ != key)
+    {
+        cpu_config_ = {};
+        cpu_tuned_key_.reset();
+    }
+    const auto* tuned_config = cpu_tuned_key_ ? nullptr : cpu_tuning_cache_.find(key);
+    if (tuned_config)
+    {
+        cpu_config_ = *tuned_config;
+        cpu_tuned_key_ = key;
+    }
+    if (params_.cpu_autotune && !cpu_tuned_key_)
     {
-        const auto data = DirectX::PackedVector::XMConvertHalfToFloat(data_f16[i]);
-        const auto ref = DirectX::PackedVector::XMConvertHalfToFloat(data_f16_ref[i]);
-        if (data != ref)
+        std::cout << "[QuantizedGemm] Tuning M: " << desc.M << ", K: " << params_.K << ", N: " << params_.N << " on " << cpu::get_cpu_model() << "." << std::endl;
+        cpu_config_ = cpu::tune_quantized_gemm(*cpu_ctx, cpu_prepared_->weights, desc.M);
+        cpu_tuned_key_ = key;
+        std::cout << "[QuantizedGemm] Tuned dequantization: " << cpu::to_string(cpu_config_.dequantization) << ", engine: " << cpu::to_string(cpu_config_.engine)
+            << ", mc: " << cpu_config_.mc << ", nc_panels: " << cpu_config_.nc_panels << ", kc: " << cpu_config_.kc << ", threads: " << cpu_config_.threads << std::endl;
+        if (!params_.cpu_tuning_cache_path.empty())
         {
-            const auto str = std::format("Conformance failed. Data: {}, ref: {}, index: {}\n", data, ref, i);
-            std::cout << str << std::endl;
-            return false;
+            // read again, other operators may have added their shapes since this one was created
+            if (std::filesystem::exists(params_.cpu_tuning_cache_path))
+            {
+                cpu_tuning_cache_.load(params_.cpu_tuning_cache_path);
+            }
+            cpu_tuning_cache_.insert(key, cpu_config_);
+            cpu_tuning_cache_.save(params_.cpu_tuning_cache_path);
         }
     }
+}
+
+std::vector<std::byte> op::QuantizedGemm::run(cpu::CpuContext* cpu_ctx)
+{
+    std::vector<std::byte> ret(get_output_size());
+    run(cpu_ctx, ret);
+    return ret;
+}
+
+void op::QuantizedGemm::run(cpu::CpuContext* cpu_ctx, std::span<std::byte> out)
+{
+    assert(cpu_prepared_ && cpu_prepared_->ctx == cpu_ctx);
+    assert(out.size() >= get_output_size());
+    const cpu::quantized_gemm_epilogue_t epilogue{ params_.epilogue, tensors_[RESOURCE_INDEX_BIAS].get_data() };
+    cpu::quantized_gemm(*cpu_ctx, cpu_prepared_->weights, params_.M, tensors_[RESOURCE_INDEX_A].get_data(), out, epilogue, tensors_[RESOURCE_INDEX_RESIDUAL].get_data(), cpu_config_);
+}
+
+cpu::quantized_gemm_config_t op::QuantizedGemm::resolve_cpu_config(cpu::CpuContext* cpu_ctx, std::uint32_t M) const
+{
+    assert(cpu_prepared_ && cpu_prepared_->ctx == cpu_ctx);
+    return cpu::resolve_config(*cpu_ctx, cpu_prepared_->weights, M, cpu_config_);
+}
+
+std::vector<std::vector<std::byte>> op::QuantizedGemm::run_batched(cpu::CpuContext* cpu_ctx, const std::vector<std::span<const std::byte>>& activations)
+{
+    const std::size_t a_row_bytes = tensor::get_size_in_bytes(tensors_[RESOURCE_INDEX_A].get_desc().data_type, params_.K);
+    const std::size_t out_row_bytes = tensor::get_size_in_bytes(tensors_[RESOURCE_INDEX_OUT].get_desc().data_type, params_.N);
+
+    std::vector<std::vector<std::byte>> ret(activations.size());
+    std::vector<std::span<std::byte>> outputs(activations.size());
+    for (std::size_t i = 0; i < activations.size(); i++)
+    {
+        ret[i].resize(activations[i].size() / a_row_bytes * out_row_bytes);
+        outputs[i] = ret[i];
+    }
+    run_batched(cpu_ctx, activations, outputs);
+    return ret;
+}
+
+void op::QuantizedGemm::run_batched(cpu::CpuContext* cpu_ctx, std::span<const std::span<const std::byte>> activations, std::span<const std::span<std::byte>> outputs)
+{
+    assert(cpu_prepared_ && cpu_prepared_->ctx == cpu_ctx);
+    assert(activations.size() == outputs.size());
+    const std::size_t a_row_bytes = tensor::get_size_in_bytes(tensors_[RESOURCE_INDEX_A].get_desc().data_type, params_.K);
+    [[maybe_unused]] const std::size_t out_row_bytes = tensor::get_size_in_bytes(tensors_[RESOURCE_INDEX_OUT].get_desc().data_type, params_.N);
+
+    auto& arena = cpu_ctx->get_arena();
+    const cpu::ArenaScope arena_scope(arena);
+    const auto batch = arena.allocate<cpu::quantized_gemm_batch_item_t>(activations.size());
+    for (std::size_t i = 0; i < activations.size(); i++)
+    {
+        assert(activations[i].size() % a_row_bytes == 0);
+        const auto M = static_cast<std::uint32_t>(activations[i].size() / a_row_bytes);
+        assert(outputs[i].size() >= M * out_row_bytes);
+        assert(!params_.epilogue.residual || M <= params_.M);
+        std::construct_at(&batch[i], cpu::quantized_gemm_batch_item_t{ M, activations[i], outputs[i], tensors_[RESOURCE_INDEX_RESIDUAL].get_data() });
+    }
+    const cpu::quantized_gemm_epilogue_t epilogue{ params_.epilogue, tensors_[RESOURCE_INDEX_BIAS].get_data() };
+    cpu::quantized_gemm(*cpu_ctx, cpu_prepared_->weights, batch, epilogue, cpu_config_);
+}
+
+std::vector<std::byte> op::QuantizedGemm::execute(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config)
+{
+    std::vector<std::byte> ret(get_output_size());
+    execute(cpu_ctx, config, ret);
+    return ret;
+}
+
+void op::QuantizedGemm::execute(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config, std::span<std::byte> out)
+{
+    prepare(cpu_ctx, config);
+    for (std::size_t i = 0; i < config.iters; i++)
+    {
+        run(cpu_ctx, out);
+    }
+}
+
+#endif  // #if BUILD_CPU
+
+std::size_t op::QuantizedGemm::get_output_size() const
+{
+    return tensors_[RESOURCE_INDEX_OUT].get_size_in_bytes();
+}
 
-    std::cout << "Conformance passed" << std::endl;
-    return true;
+std::vector<std::byte> op::QuantizedGemm::execute_reference(cpu::CpuContext* cpu_ctx, const execute_reference_config_t& config)
+{
+    cpu::reference_quantized_gemm_desc_t desc{ params_.M, params_.K, params_.N, params_.block_size, params_.b_transposed, params_.quantization };
+    desc.accumulation = config.fp64_accumulation ? cpu::REFERENCE_ACCUMULATION_FP64 : cpu::REFERENCE_ACCUMULATION_FP32;
+    desc.dynamic_quantization = params_.dynamic_quantization;
+    desc.epilogue = params_.epilogue;
+    std::vector<std::byte> ret(get_output_size());
+    cpu::reference_quantized_gemm(*cpu_ctx, desc, tensors_[RESOURCE_INDEX_A].get_data(), tensors_[RESOURCE_INDEX_B].get_data(),
+        tensors_[RESOURCE_INDEX_B_QUANTIZATION_SCALE].get_data(), tensors_[RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT].get_data(),
+        tensors_[RESOURCE_INDEX_BIAS].get_data(), tensors_[RESOURCE_INDEX_RESIDUAL].get_data(), ret);
+    return ret;
+}
+
+bool op::QuantizedGemm::compare(const std::vector<std::byte>& lhs, const std::vector<std::byte>& rhs, const compare_config_t& config)
+{
+    assert(lhs.size() == rhs.size());
+    std::unique_ptr<cpu::CpuContext> temporary_ctx{};
+    cpu::CpuContext* cpu_ctx = config.cpu_ctx;
+    if (!cpu_ctx)
+    {
+        temporary_ctx = std::make_unique<cpu::CpuContext>();
+        cpu_ctx = temporary_ctx.get();
+    }
+
+    cpu::compare_params_t params{};
+    params.abs_tolerance = config.abs_tolerance;
+    params.rel_tolerance = config.rel_tolerance;
+    params.ulp_tolerance = config.ulp_tolerance;
+    params.max_reported_mismatches = config.max_reported_mismatches;
+    // requantized outputs are allowed one step: the accumulation order of a backend moves values right at a rounding boundary
+    if (params_.epilogue.requantize)
+    {
+        params.abs_tolerance = std::max(params.abs_tolerance, 1.0f);
+    }
+    const auto result = params_.epilogue.requantize ? cpu::compare_int8(*cpu_ctx, lhs, rhs, params_.M, params_.N, params)
+        : cpu::compare_fp16(*cpu_ctx, lhs, rhs, params_.M, params_.N, params);
+
+    std::cout << (result.passed ? "Conformance passed." : "Conformance failed.")
+        << " Mismatches: " << result.mismatches_count << " / " << result.elements_count
+        << ", max abs error: " << result.max_abs_error
+        << ", max rel error: " << result.max_rel_error
+        << ", mean abs error: " << result.mean_abs_error
+        << ", max ulp error: " << result.max_ulp_error << std::endl;
+    for (const auto& mismatch : result.first_mismatches)
+    {
+        std::cout << "    (m: " << mismatch.m << ", n: " << mismatch.n << ") data: " << mismatch.value << ", ref: " << mismatch.reference << std::endl;
+    }
+    return result.passed;
 }
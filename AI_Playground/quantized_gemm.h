@@ -1,7 +1,20 @@
 #pragma once
 #include "ioperator.h"
+#include "cpu_mapped_file.h"
+#include "cpu_tensor_init.h"
+#include "epilogue.h"
+#include "quantization.h"
+#include "tensor.h"
+#if BUILD_CPU
+#include "cpu_quantized_gemm.h"
+#include "cpu_quantized_gemm_tuner.h"
+#endif
 
 #include <array>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
 
 namespace op
 {
@@ -9,39 +22,139 @@ namespace op
 class QuantizedGemm : public IOperator
 {
 public:
+    // Tensor contents. Every tensor gets its own random stream derived from seed,
+    // defaults are in the range of int4 quantized LLM weights and activations.
+    struct init_params_t
+    {
+        cpu::distribution_t a{ cpu::DISTRIBUTION_NORMAL, 0.0f, 1.0f };
+        std::optional<cpu::distribution_t> b{};     // default: uniform over the codes of the quantization scheme
+        cpu::distribution_t b_scale{ cpu::DISTRIBUTION_UNIFORM, 0.001f, 0.02f };
+        cpu::distribution_t b_zero_point{ cpu::DISTRIBUTION_UNIFORM, 0.0f, 15.0f };
+        cpu::distribution_t bias{ cpu::DISTRIBUTION_NORMAL, 0.0f, 1.0f };
+        cpu::distribution_t residual{ cpu::DISTRIBUTION_NORMAL, 0.0f, 1.0f };
+        std::uint64_t seed = 0;
+
+        // B, scales and zero points are mapped from a weights file (see cpu_weights_file.h) instead and used in place, its shape has to match
+        std::filesystem::path weights_path{};
+    };
+
     struct create_params_t
     {
         std::uint32_t M = 16;
         std::uint32_t K = 32;
         std::uint32_t N = 16;
-        std::uint32_t block_size = 16;
+        std::uint32_t block_size = 16;  // ignored by per channel schemes
 
-        bool b_transposed = true;
+        bool b_transposed = true;   // B is [N, K], otherwise [K, N], the quantization params follow B
+        // B data type, quantization params and dequantization, see quantization.h. Only the asymmetric scheme has zero points.
+        quant::SCHEME quantization = quant::SCHEME_UINT4_ASYMMETRIC;
+        // A quantized to int8 on the fly and multiplied on integer dot products (W4A8 / W8A8), part of the operation so the golden model
+        // rounds A the same way. CPU only, see quant::supports_dynamic_quantization() for the schemes.
+        quant::DYNAMIC_QUANTIZATION dynamic_quantization = quant::DYNAMIC_QUANTIZATION_NONE;
+        // post-ops fused into the GEMM, see epilogue.h. Adds the bias [N] and residual [M, N] inputs, OUT is int8 when requantized.
+        epilogue::desc_t epilogue{};
+
+        init_params_t init{};
+        cpu::CpuContext* cpu_ctx = nullptr;     // fills the tensors, nullptr uses a temporary context
+#if BUILD_CPU
+        // CPU execution choices measured per shape and host (see cpu_quantized_gemm_tuner.h): the cache is loaded here and the entry of this
+        // shape on cpu_ctx's host becomes the CPU config. prepare(cpu_ctx, config) looks up the rows the calls run (execute_cpu_config_t::rows)
+        // instead when they differ, with autotune a shape missing from it is tuned there and the cache file (if any) is rewritten with the result.
+        std::filesystem::path cpu_tuning_cache_path{};
+        bool cpu_autotune = false;
+#endif
     };
 public:
     QuantizedGemm(const create_params_t& params);
+    ~QuantizedGemm();
 
+#if BUILD_DX12
+    void prepare(dx12::Dx12Context* dx_ctx, const execute_dml_config_t& config) override;
+    std::vector<std::byte> run(dx12::Dx12Context* dx_ctx) override;
+    void run(dx12::Dx12Context* dx_ctx, std::span<std::byte> out) override;
     std::vector<std::byte> execute(dx12::Dx12Context* dml_ctx, const execute_dml_config_t& config) override;
+    void execute(dx12::Dx12Context* dml_ctx, const execute_dml_config_t& config, std::span<std::byte> out) override;
+#endif
+#if BUILD_CPU
+    void prepare(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config) override;
+    std::vector<std::byte> run(cpu::CpuContext* cpu_ctx) override;
+    void run(cpu::CpuContext* cpu_ctx, std::span<std::byte> out) override;
+    std::vector<std::byte> execute(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config) override;
+    void execute(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config, std::span<std::byte> out) override;
+
+    // Continuous batching: every activation is an independent [M_i, K] fp16 matrix (M_i taken from its size) sharing this operator's B and epilogue.
+    // Returns one [M_i, N] output per activation, B is read once for the whole batch. Needs prepare(cpu_ctx, ...) first.
+    // With a residual epilogue request i adds rows [0, M_i) of the operator's residual, so M_i <= M.
+    std::vector<std::vector<std::byte>> run_batched(cpu::CpuContext* cpu_ctx, const std::vector<std::span<const std::byte>>& activations);
+    // Same, output i is written to outputs[i] ([M_i, N]).
+    void run_batched(cpu::CpuContext* cpu_ctx, std::span<const std::span<const std::byte>> activations, std::span<const std::span<std::byte>> outputs);
+
+    // Execution choices of the following CPU calls (see cpu_quantized_gemm.h), they don't need another prepare().
+    // Replaces the tuned config, if any.
+    void set_cpu_config(const cpu::quantized_gemm_config_t& config) { cpu_config_ = config; cpu_tuned_key_.reset(); }
+    const cpu::quantized_gemm_config_t& get_cpu_config() const { return cpu_config_; }
+    // The CPU config came from the tuning cache or the tuner.
+    bool is_cpu_tuned() const { return cpu_tuned_key_.has_value(); }
+    // What the calls with M rows run (see cpu::resolve_config()), needs prepare(cpu_ctx, ...) first.
+    cpu::quantized_gemm_config_t resolve_cpu_config(cpu::CpuContext* cpu_ctx, std::uint32_t M) const;
+#endif
+
     std::vector<std::byte> execute(cuda::CudaContext* cu_ctx, const execute_cuda_config_t& config) override;
+    void execute(cuda::CudaContext* cu_ctx, const execute_cuda_config_t& config, std::span<std::byte> out) override;
 
-    bool compare(const std::vector<std::byte>& lhs, const std::vector<std::byte>& rhs) override;
+    std::size_t get_output_size() const override;
+
+    std::vector<std::byte> execute_reference(cpu::CpuContext* cpu_ctx, const execute_reference_config_t& config) override;
+
+    // A of run(), [M, K] fp16
+    std::span<const std::byte> get_activations() const { return tensors_[RESOURCE_INDEX_A].get_data(); }
+
+    // Writes B, scales and zero points as a weights file, can be loaded again with init_params_t::weights_path.
+    bool save_weights(const std::filesystem::path& path) const;
+
+    bool compare(const std::vector<std::byte>& lhs, const std::vector<std::byte>& rhs, const compare_config_t& config) override;
 
 private:
     enum RESOURCE_INDEX
     {
         RESOURCE_INDEX_A,
         RESOURCE_INDEX_B,
-        //RESOURCE_INDEX_C,
         RESOURCE_INDEX_B_QUANTIZATION_SCALE,
         RESOURCE_INDEX_B_QUANTIZATION_ZERO_POINT,
+        // epilogue inputs, empty when not enabled
+        RESOURCE_INDEX_BIAS,
+        RESOURCE_INDEX_RESIDUAL,
         // end of input resources
         RESOURCE_INDEX_OUT,
         // ..
         RESOURCE_INDEX_COUNT
     };
 
+    // backend state cached by prepare()
+    struct dml_prepared_t;
+    struct cpu_prepared_t;
+
+#if BUILD_CPU
+    cpu::quantized_gemm_desc_t get_cpu_desc() const;
+    // packs the weights for the context, or maps them from config.packed_weights_path
+    std::unique_ptr<cpu_prepared_t> prepare_cpu_weights(cpu::CpuContext* cpu_ctx, const execute_cpu_config_t& config) const;
+#endif
+
 private:
-    std::array<std::vector<std::byte>, RESOURCE_INDEX_COUNT> data_host_;
+    std::array<tensor::Tensor, RESOURCE_INDEX_COUNT> data_host_;
+    cpu::MappedFile weights_file_{};
+    // what the backends read: views of data_host_ or, for the weights, of the mapped weights file
+    std::array<tensor::TensorView, RESOURCE_INDEX_COUNT> tensors_{};
     const create_params_t params_;
+
+#if BUILD_DX12
+    std::unique_ptr<dml_prepared_t> dml_prepared_;
+#endif
+#if BUILD_CPU
+    std::unique_ptr<cpu_prepared_t> cpu_prepared_;
+    cpu::quantized_gemm_config_t cpu_config_{};
+    cpu::TuningCache cpu_tuning_cache_{};
+    std::optional<cpu::tuning_key_t> cpu_tuned_key_{};   // what cpu_config_ was tuned for, when it came from the tuning cache or the tuner
+#endif
 };
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "tensor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+const char* tensor::to_string(DATA_TYPE data_type)
+{
+    switch (data_type)
+    {
+    case DATA_TYPE_FP16: return "fp16";
+    case DATA_TYPE_FP32: return "fp32";
+    case DATA_TYPE_BF16: return "bf16";
+    case DATA_TYPE_INT8: return "int8";
+    case DATA_TYPE_UINT4: return "uint4";
+    case DATA_TYPE_INT4: return "int4";
+    default: return "unknown";
+    }
+}
+
+std::uint64_t tensor::desc_t::get_elements_count() const
+{
+    std::uint64_t count = 1;
+    for (std::uint32_t i = 0; i < rank; i++)
+    {
+        count *= shape[i];
+    }
+    return count;
+}
+
+std::uint64_t tensor::desc_t::get_size_in_bytes() const
+{
+    if (get_elements_count() == 0)
+    {
+        return 0;
+    }
+    std::uint64_t last_offset = 0;
+    for (std::uint32_t i = 0; i < rank; i++)
+    {
+        last_offset += (shape[i] - 1) * strides[i];
+    }
+    return tensor::get_size_in_bytes(data_type, last_offset + 1);
+}
+
+bool tensor::desc_t::is_packed() const
+{
+    std::uint64_t stride = 1;
+    for (std::uint32_t i = rank; i-- > 0;)
+    {
+        if (shape[i] != 1 && strides[i] != stride)
+        {
+            return false;
+        }
+        stride *= shape[i];
+    }
+    return true;
+}
+
+tensor::desc_t tensor::make_desc(DATA_TYPE data_type, std::initializer_list<std::uint64_t> shape, std::size_t alignment)
+{
+    assert(shape.size() <= MAX_RANK);
+    desc_t desc{};
+    desc.data_type = data_type;
+    desc.rank = static_cast<std::uint32_t>(shape.size());
+    desc.alignment = alignment;
+    std::copy(shape.begin(), shape.end(), desc.shape.begin());
+    std::uint64_t stride = 1;
+    for (std::uint32_t i = desc.rank; i-- > 0;)
+    {
+        desc.strides[i] = stride;
+        stride *= desc.shape[i];
+    }
+    return desc;
+}
+
+tensor::TensorView::TensorView(const desc_t& desc, std::span<const std::byte> data)
+    : desc_(desc)
+{
+    assert(data.size() >= desc.get_size_in_bytes());
+    assert(reinterpret_cast<std::uintptr_t>(data.data()) % desc.alignment == 0);
+    data_ = data.first(desc.get_size_in_bytes());
+}
+
+tensor::Tensor::Tensor(const desc_t& desc)
+    : desc_(desc)
+    , size_(desc.get_size_in_bytes())
+{
+    const std::size_t alignment = std::max(desc.alignment, DEFAULT_ALIGNMENT);
+    if (size_ != 0)
+    {
+        data_ = std::unique_ptr<std::byte[], aligned_deleter_t>(static_cast<std::byte*>(::operator new(size_, std::align_val_t(alignment))), aligned_deleter_t{ alignment });
+    }
+}
+
+void tensor::aligned_deleter_t::operator()(std::byte* data) const
+{
+    ::operator delete(data, std::align_val_t(alignment));
+}
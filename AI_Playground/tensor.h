@@ -0,0 +1,112 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <span>
+
+namespace tensor
+{
+enum DATA_TYPE
+{
+    DATA_TYPE_FP16,
+    DATA_TYPE_FP32,
+    DATA_TYPE_BF16,
+    DATA_TYPE_INT8,
+    DATA_TYPE_UINT4,    // two per byte, low nibble first
+    DATA_TYPE_INT4,     // two per byte, low nibble first, two's complement
+    // ..
+    DATA_TYPE_COUNT
+};
+
+const char* to_string(DATA_TYPE data_type);
+
+constexpr std::uint32_t get_bits(DATA_TYPE data_type)
+{
+    switch (data_type)
+    {
+    case DATA_TYPE_FP32: return 32;
+    case DATA_TYPE_FP16:
+    case DATA_TYPE_BF16: return 16;
+    case DATA_TYPE_INT8: return 8;
+    case DATA_TYPE_UINT4:
+    case DATA_TYPE_INT4: return 4;
+    default: return 0;
+    }
+}
+
+// Bytes of elements_count tightly packed elements, sub byte types round up to a whole byte.
+constexpr std::uint64_t get_size_in_bytes(DATA_TYPE data_type, std::uint64_t elements_count)
+{
+    return (elements_count * get_bits(data_type) + 7) / 8;
+}
+
+constexpr std::uint32_t MAX_RANK = 4;
+// of the buffers allocated by Tensor
+constexpr std::size_t DEFAULT_ALIGNMENT = 64;
+
+// Data type, shape and memory layout of a tensor, outermost dimension first.
+// Strides are in elements, sub byte elements are addressed as offset * bits / 8 (nibbles are packed across rows).
+struct desc_t
+{
+    DATA_TYPE data_type = DATA_TYPE_FP16;
+    std::uint32_t rank = 0;
+    std::array<std::uint64_t, MAX_RANK> shape{};
+    std::array<std::uint64_t, MAX_RANK> strides{};
+    std::size_t alignment = 1;  // required of the address of the first element
+
+    std::uint64_t get_elements_count() const;
+    // from the first element up to and including the last one
+    std::uint64_t get_size_in_bytes() const;
+    // row major without padding
+    bool is_packed() const;
+};
+
+// Packed row major layout of shape.
+desc_t make_desc(DATA_TYPE data_type, std::initializer_list<std::uint64_t> shape, std::size_t alignment = 1);
+
+// Typed view of memory it doesn't own (a mapped file, a caller's buffer, a Tensor), valid as long as that memory is.
+class TensorView
+{
+public:
+    TensorView() = default;
+    TensorView(const desc_t& desc, std::span<const std::byte> data);
+
+    const desc_t& get_desc() const { return desc_; }
+    std::span<const std::byte> get_data() const { return data_; }
+    std::uint64_t get_size_in_bytes() const { return data_.size(); }
+    bool empty() const { return data_.empty(); }
+
+private:
+    desc_t desc_{};
+    std::span<const std::byte> data_{};
+};
+
+// Releases buffers allocated with an explicit alignment.
+struct aligned_deleter_t
+{
+    std::size_t alignment = DEFAULT_ALIGNMENT;
+    void operator()(std::byte* data) const;
+};
+
+// Owns an uninitialized buffer of desc.get_size_in_bytes() bytes, aligned to at least DEFAULT_ALIGNMENT.
+class Tensor
+{
+public:
+    Tensor() = default;
+    Tensor(const desc_t& desc);
+
+    const desc_t& get_desc() const { return desc_; }
+    std::span<std::byte> get_data() const { return { data_.get(), size_ }; }
+    std::uint64_t get_size_in_bytes() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    TensorView get_view() const { return TensorView(desc_, get_data()); }
+
+private:
+    desc_t desc_{};
+    std::unique_ptr<std::byte[], aligned_deleter_t> data_{};
+    std::size_t size_ = 0;
+};
+}
@@ -0,0 +1,315 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+thread_local const cpu::ThreadPool* tls_current_pool = nullptr;
+
+struct logical_cpu_t
+{
+    std::uint32_t group = 0;    // processor group on Windows, unused on Linux
+    std::uint32_t id = 0;
+    std::uint32_t numa_node = 0;
+};
+
+#if defined(__linux__)
+// "0-3,8-11" -> { 0, 1, 2, 3, 8, 9, 10, 11 }
+std::vector<std::uint32_t> parse_cpu_list(const std::string& list)
+{
+    std::vector<std::uint32_t> ret{};
+    std::size_t pos = 0;
+    while (pos < list.size())
+    {
+        const auto comma = std::min(list.find(',', pos), list.size());
+        const auto range = list.substr(pos, comma - pos);
+        const auto dash = range.find('-');
+        try
+        {
+            const auto first = static_cast<std::uint32_t>(std::stoul(range.substr(0, dash)));
+            const auto last = dash == std::string::npos ? first : static_cast<std::uint32_t>(std::stoul(range.substr(dash + 1)));
+            for (auto cpu = first; cpu <= last; cpu++)
+            {
+                ret.push_back(cpu);
+            }
+        }
+        catch (const std::exception&)
+        {
+            // ignore malformed entries
+        }
+        pos = comma + 1;
+    }
+    return ret;
+}
+#endif
+
+// Logical cpus this process may run on, ordered node by node.
+std::vector<logical_cpu_t> query_logical_cpus()
+{
+    std::vector<logical_cpu_t> cpus{};
+#if defined(__linux__)
+    cpu_set_t allowed{};
+    const bool has_affinity = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    for (std::uint32_t node = 0; ; node++)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file)
+        {
+            break;
+        }
+        std::string list{};
+        std::getline(file, list);
+        for (const auto id : parse_cpu_list(list))
+        {
+            if (!has_affinity || (id < CPU_SETSIZE && CPU_ISSET(id, &allowed)))
+            {
+                cpus.push_back({ 0, id, node });
+            }
+        }
+    }
+    if (cpus.empty() && has_affinity)
+    {
+        // no NUMA information exposed, single node
+        for (std::uint32_t id = 0; id < CPU_SETSIZE; id++)
+        {
+            if (CPU_ISSET(id, &allowed))
+            {
+                cpus.push_back({ 0, id, 0 });
+            }
+        }
+    }
+#elif defined(_WIN32)
+    ULONG highest_node = 0;
+    if (GetNumaHighestNodeNumber(&highest_node))
+    {
+        for (USHORT node = 0; node <= highest_node; node++)
+        {
+            GROUP_AFFINITY affinity{};
+            if (!GetNumaNodeProcessorMaskEx(node, &affinity))
+            {
+                continue;
+            }
+            for (std::uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; bit++)
+            {
+                if (affinity.Mask & (KAFFINITY(1) << bit))
+                {
+                    cpus.push_back({ affinity.Group, bit, node });
+                }
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+void pin_current_thread(const logical_cpu_t& cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set{};
+    CPU_ZERO(&set);
+    CPU_SET(cpu.id, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+    GROUP_AFFINITY affinity{};
+    affinity.Group = static_cast<WORD>(cpu.group);
+    affinity.Mask = KAFFINITY(1) << cpu.id;
+    SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+#else
+    (void)cpu;
+#endif
+}
+}
+
+cpu::ThreadPool::ThreadPool(const create_params_t& params)
+{
+    auto threads_count = params.threads_count;
+    if (threads_count == 0)
+    {
+        threads_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const bool pin = params.pin_threads || params.numa_aware;
+    const auto cpus = pin ? query_logical_cpus() : std::vector<logical_cpu_t>{};
+
+    workers_.resize(threads_count);
+    for (std::uint32_t i = 0; i < threads_count; i++)
+    {
+        workers_[i] = std::make_unique<worker_t>();
+        if (!cpus.empty())
+        {
+            workers_[i]->numa_node = cpus[i % cpus.size()].numa_node;
+            numa_nodes_count_ = std::max(numa_nodes_count_, workers_[i]->numa_node + 1);
+        }
+    }
+
+    // victims are visited round robin starting from the next worker, in NUMA mode workers of the same node come first
+    for (std::uint32_t i = 0; i < threads_count; i++)
+    {
+        auto& order = workers_[i]->steal_order;
+        for (std::uint32_t j = 1; j < threads_count; j++)
+        {
+            order.push_back((i + j) % threads_count);
+        }
+        if (params.numa_aware)
+        {
+            const auto node = workers_[i]->numa_node;
+            std::stable_partition(order.begin(), order.end(), [&](std::uint32_t victim) { return workers_[victim]->numa_node == node; });
+        }
+    }
+
+    // worker 0 is whichever thread calls parallel_for(), it is never pinned
+    threads_.reserve(threads_count - 1);
+    for (std::uint32_t i = 1; i < threads_count; i++)
+    {
+        threads_.emplace_back([this, i, cpus]()
+            {
+                if (!cpus.empty())
+                {
+                    pin_current_thread(cpus[i % cpus.size()]);
+                }
+                worker_loop(i);
+            });
+    }
+}
+
+cpu::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void cpu::ThreadPool::parallel_for(std::size_t tasks_count, const std::function<void(std::size_t, std::uint32_t)>& fn)
+{
+    if (tasks_count == 0)
+    {
+        return;
+    }
+    if (workers_.size() == 1 || tasks_count == 1 || tls_current_pool == this)
+    {
+        for (std::size_t i = 0; i < tasks_count; i++)
+        {
+            fn(i, 0);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> job_lock(job_mutex_);
+    const auto workers_count = workers_.size();
+    for (std::size_t i = 0; i < workers_count; i++)
+    {
+        std::lock_guard<std::mutex> lock(workers_[i]->mutex);
+        workers_[i]->begin = i * tasks_count / workers_count;
+        workers_[i]->end = (i + 1) * tasks_count / workers_count;
+    }
+    job_fn_ = &fn;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        pending_workers_ = static_cast<std::uint32_t>(workers_count - 1);
+        generation_++;
+    }
+    wake_cv_.notify_all();
+
+    tls_current_pool = this;
+    drain(0);
+    tls_current_pool = nullptr;
+
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    done_cv_.wait(lock, [this]() { return pending_workers_ == 0; });
+    job_fn_ = nullptr;
+}
+
+void cpu::ThreadPool::worker_loop(std::uint32_t worker_idx)
+{
+    tls_current_pool = this;
+    std::uint64_t seen_generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            wake_cv_.wait(lock, [&]() { return stop_ || generation_ != seen_generation; });
+            if (stop_)
+            {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        drain(worker_idx);
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (--pending_workers_ == 0)
+        {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void cpu::ThreadPool::drain(std::uint32_t worker_idx)
+{
+    std::size_t task_idx = 0;
+    while (pop(worker_idx, task_idx) || steal(worker_idx, task_idx))
+    {
+        (*job_fn_)(task_idx, worker_idx);
+    }
+}
+
+bool cpu::ThreadPool::pop(std::uint32_t worker_idx, std::size_t& task_idx)
+{
+    auto& worker = *workers_[worker_idx];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.begin == worker.end)
+    {
+        return false;
+    }
+    task_idx = worker.begin++;
+    return true;
+}
+
+bool cpu::ThreadPool::steal(std::uint32_t worker_idx, std::size_t& task_idx)
+{
+    auto& thief = *workers_[worker_idx];
+    for (const auto victim_idx : thief.steal_order)
+    {
+        auto& victim = *workers_[victim_idx];
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            const auto remaining = victim.end - victim.begin;
+            if (remaining == 0)
+            {
+                continue;
+            }
+            // take the back half, the victim keeps the tasks it is about to touch
+            begin = victim.end - (remaining + 1) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+        task_idx = begin;
+        std::lock_guard<std::mutex> lock(thief.mutex);
+        thief.begin = begin + 1;
+        thief.end = end;
+        return true;
+    }
+    return false;
+}
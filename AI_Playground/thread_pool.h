@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpu
+{
+// Persistent workers with per-worker task deques and work stealing.
+// parallel_for() splits the task range into contiguous chunks, one per worker, so the same task index always starts on the same worker:
+// data first touched by a task (ex. a packed panel of B) stays local to the worker that later computes with it.
+// A worker drains its own deque front to back and, once empty, steals the back half of another worker's deque.
+class ThreadPool
+{
+public:
+    struct create_params_t
+    {
+        std::uint32_t threads_count = 0;    // 0 means use all hardware threads
+        bool pin_threads = false;           // pin worker i to the i-th logical cpu
+        bool numa_aware = false;            // pin workers node by node and steal from the same node first
+    };
+
+public:
+    ThreadPool(const create_params_t& params);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::uint32_t get_threads_count() const { return static_cast<std::uint32_t>(workers_.size()); }
+    std::uint32_t get_numa_nodes_count() const { return numa_nodes_count_; }
+
+    // Runs fn(task_idx, worker_idx) for every task_idx in [0, tasks_count), the calling thread works as worker 0.
+    // Calls from inside a task run serially on the calling worker.
+    void parallel_for(std::size_t tasks_count, const std::function<void(std::size_t, std::uint32_t)>& fn);
+
+private:
+    struct worker_t
+    {
+        std::mutex mutex;
+        std::size_t begin = 0;   // deque of task indices [begin, end)
+        std::size_t end = 0;
+        std::uint32_t numa_node = 0;
+        std::vector<std::uint32_t> steal_order;
+    };
+
+    void worker_loop(std::uint32_t worker_idx);
+    void drain(std::uint32_t worker_idx);
+    bool pop(std::uint32_t worker_idx, std::size_t& task_idx);
+    bool steal(std::uint32_t worker_idx, std::size_t& task_idx);
+
+private:
+    std::vector<std::unique_ptr<worker_t>> workers_;
+    std::vector<std::thread> threads_;
+    std::uint32_t numa_nodes_count_ = 1;
+
+    std::mutex job_mutex_;  // one parallel_for at a time
+    const std::function<void(std::size_t, std::uint32_t)>* job_fn_ = nullptr;
+
+    std::mutex state_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+    std::uint64_t generation_ = 0;
+    std::uint32_t pending_workers_ = 0;
+    bool stop_ = false;
+};
+}